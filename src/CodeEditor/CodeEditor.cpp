@@ -15,6 +15,8 @@ wxIMPLEMENT_CLASS(wxCodeEditor, wxStyledTextCtrl)
 wxBEGIN_EVENT_TABLE(wxCodeEditor, wxStyledTextCtrl)
     EVT_STC_MARGINCLICK(wxID_ANY, wxCodeEditor::OnMarginClick)
     EVT_STC_CHARADDED(wxID_ANY, wxCodeEditor::OnCharAdded)
+    EVT_STC_MODIFIED(wxID_ANY, wxCodeEditor::OnModified)
+    EVT_TIMER(wxID_ANY, wxCodeEditor::OnParseTimer)
     EVT_STC_AUTOCOMP_SELECTION(wxID_ANY, wxCodeEditor::OnAutoCompletionSelected)
     EVT_KEY_DOWN(wxCodeEditor::OnKeyDown)
     EVT_FIND(wxID_ANY, wxCodeEditor::OnFind)
@@ -23,7 +25,13 @@ wxEND_EVENT_TABLE()
 
 wxCodeEditor::wxCodeEditor(wxWindow* parent, wxWindowID id/*=wxID_ANY*/, const wxPoint& pos/*=wxDefaultPosition*/,
                            const wxSize& size/*=wxDefaultSize*/, long style/*=0*/, const wxString& name/*"wxCodeEditor"*/) :
-    wxStyledTextCtrl(parent, id, pos, size, style, name)
+    wxStyledTextCtrl(parent, id, pos, size, style, name),
+    m_parseTimer(this),
+    m_luaParser([this](wxLuaParser::Results results)
+        {
+        // (called on the parser's thread)
+        CallAfter([this, results]() { ApplyParseResults(results); });
+        })
     {
     StyleClearAll();
     const wxFont font(wxFontInfo(10).Family(wxFONTFAMILY_MODERN));
@@ -53,6 +61,16 @@ wxCodeEditor::wxCodeEditor(wxWindow* parent, wxWindowID id/*=wxID_ANY*/, const w
     AutoCompSetAutoHide(true);
 
     CallTipUseStyle(40);
+
+    IndicatorSetStyle(PARSE_ERROR_INDICATOR, wxSTC_INDIC_SQUIGGLE);
+    IndicatorSetForeground(PARSE_ERROR_INDICATOR, *wxRED);
+    }
+
+wxCodeEditor::~wxCodeEditor()
+    {
+    m_parseTimer.Stop();
+    // (results that it already sent are discarded along with this window's pending events)
+    m_luaParser.Stop();
     }
 
 void wxCodeEditor::SetLanguage(const int lang)
@@ -66,6 +84,10 @@ void wxCodeEditor::SetLanguage(const int lang)
         SetFileFilter(_("Lua Script (*.lua)|*.lua"));
         SetLibraryAccessor(L'.');
         SetObjectAccessor(L':');
+        m_backgroundParsing = true;
+        m_parseTimer.Start(PARSE_DELAY_MILLISECONDS, wxTIMER_ONE_SHOT);
+        // (any lines indexed under a previous language may be out of date)
+        RebuildAssignmentIndex();
         }
 
     // highlighting for all supported languages
@@ -248,7 +270,12 @@ void wxCodeEditor::FindNext(const wxString& textToFind, const int searchFlags /*
 void wxCodeEditor::AddFunctionsOrClasses(const std::vector<wxString>& functions)
     {
     for (size_t i = 0; i < functions.size(); ++i)
-        { m_libaryAndClassNames.insert(StripExtraInfo(functions[i])); }
+        {
+        const wxString name = StripExtraInfo(functions[i]);
+        wxCodeEditorCatalog::FoldKey(name, m_lookupKey);
+        m_libaryAndClassNames.push_back({ m_lookupKey, name });
+        }
+    m_namesSorted = false;
     }
 
 void wxCodeEditor::AddLibrary(const wxString& library, std::vector<wxString>& functions)
@@ -261,10 +288,15 @@ void wxCodeEditor::AddLibrary(const wxString& library, std::vector<wxString>& fu
         functionString += L" " + StripExtraInfo(functions[i]);
         returnTypeStr = GetReturnType(functions[i]);
         if (returnTypeStr.length())
-            { m_libraryFunctionsWithReturnTypes.insert(std::pair<wxString, wxString>(library+L"."+StripExtraInfo(functions[i]), returnTypeStr) ); }
+            {
+            wxCodeEditorCatalog::FoldKey(library+L"."+StripExtraInfo(functions[i]), m_lookupKey);
+            m_libraryFunctionsWithReturnTypes.emplace(m_lookupKey, returnTypeStr);
+            }
         }
-    m_libraryCollection.insert(std::pair<wxString, wxString>(library, functionString) );
-    m_libaryAndClassNames.insert(library);
+    wxCodeEditorCatalog::FoldKey(library, m_lookupKey);
+    m_libraryCollection.emplace(m_lookupKey, functionString);
+    m_libaryAndClassNames.push_back({ m_lookupKey, library });
+    m_namesSorted = false;
     }
 
 void wxCodeEditor::AddClass(const wxString& theClass, std::vector<wxString>& functions)
@@ -273,17 +305,168 @@ void wxCodeEditor::AddClass(const wxString& theClass, std::vector<wxString>& fun
     wxString functionString;
     for (size_t i = 0; i < functions.size(); ++i)
         { functionString += L" " + StripExtraInfo(functions[i]); }
-    m_classCollection.insert(std::pair<wxString, wxString>(theClass, functionString) );
-    m_libaryAndClassNames.insert(theClass);
+    wxCodeEditorCatalog::FoldKey(theClass, m_lookupKey);
+    m_classCollection.emplace(m_lookupKey, functionString);
+    m_libaryAndClassNames.push_back({ m_lookupKey, theClass });
+    m_namesSorted = false;
     }
 
 void wxCodeEditor::Finalize()
     {
-    for (const auto& className : m_libaryAndClassNames)
-        { m_libaryAndClassNamesStr += L" " + className; }
+    // (stable, so that the first definition of a name is the one kept)
+    std::stable_sort(m_libaryAndClassNames.begin(), m_libaryAndClassNames.end(),
+        [](const auto& first, const auto& second)
+        { return first.m_key < second.m_key; });
+    m_libaryAndClassNames.erase(
+        std::unique(m_libaryAndClassNames.begin(), m_libaryAndClassNames.end(),
+            [](const auto& first, const auto& second)
+            { return first.m_key == second.m_key; }),
+        m_libaryAndClassNames.end());
+    m_namesSorted = true;
+    // the catalog's names are already joined in its file, so if there are no others, then
+    // that is converted all at once (rather than converting and joining each name)
+    if (m_catalog != nullptr && m_libaryAndClassNames.empty())
+        {
+        const std::string_view keywords = m_catalog->GetKeywords();
+        m_libaryAndClassNamesStr = wxString::FromUTF8(keywords.data(), keywords.length());
+        }
+    else
+        {
+        // (merged with all of the catalog's names, so that the list stays sorted and has no duplicates)
+        NameMatches allNames{ NameRange(m_libaryAndClassNames.cbegin(), m_libaryAndClassNames.cend()) };
+        if (m_catalog != nullptr)
+            { allNames.m_catalogNames = { 0, m_catalog->GetEntryCount(wxCodeEditorCatalog::Table::Names) }; }
+        m_libaryAndClassNamesStr = JoinNames(allNames);
+        }
     SetKeyWords(1, m_libaryAndClassNamesStr);
     }
 
+wxCodeEditor::NameMatches wxCodeEditor::FindNamesStartingWith(const wxString& prefix) const
+    {
+    // (the names are binary searched, so they have to be sorted)
+    wxASSERT_MSG(m_namesSorted, L"Call Finalize() after adding functions, libraries and classes.");
+    // the editor's names and the catalog's are folded the same way,
+    // so the prefix is folded once (into the reused buffer) for both
+    wxCodeEditorCatalog::FoldKey(prefix, m_lookupKey);
+    const std::string_view key{ m_lookupKey };
+    NameMatches matches{ NameRange(m_libaryAndClassNames.cend(), m_libaryAndClassNames.cend()) };
+    if (m_namesSorted)
+        {
+        const auto first = std::lower_bound(m_libaryAndClassNames.cbegin(), m_libaryAndClassNames.cend(), key,
+            [](const auto& entry, const std::string_view value)
+            { return entry.m_key < value; });
+        // (the names that start with the key sort ahead of everything after it that doesn't)
+        const auto last = std::upper_bound(first, m_libaryAndClassNames.cend(), key,
+            [](const std::string_view value, const auto& entry)
+            { return value < std::string_view(entry.m_key).substr(0, value.length()); });
+        matches.m_names = NameRange(first, last);
+        }
+    if (m_catalog != nullptr)
+        { matches.m_catalogNames = m_catalog->FindPrefix(wxCodeEditorCatalog::Table::Names, key); }
+    return matches;
+    }
+
+wxString wxCodeEditor::GetFirstName(const NameMatches& matches) const
+    {
+    const bool hasName = (matches.m_names.first != matches.m_names.second);
+    if (matches.m_catalogNames.first != matches.m_catalogNames.second)
+        {
+        const size_t index = matches.m_catalogNames.first;
+        const std::string_view key = m_catalog->GetKey(wxCodeEditorCatalog::Table::Names, index);
+        if (!hasName || key < matches.m_names.first->m_key)
+            {
+            const std::string_view signature = m_catalog->GetSignature(wxCodeEditorCatalog::Table::Names, index);
+            const std::string_view name = signature.empty() ?
+                m_catalog->GetValue(wxCodeEditorCatalog::Table::Names, index) : signature;
+            return wxString::FromUTF8(name.data(), name.length());
+            }
+        }
+    return hasName ? matches.m_names.first->m_name : wxString{};
+    }
+
+wxString wxCodeEditor::JoinNames(const NameMatches& matches) const
+    {
+    wxString joinedNames;
+    const auto appendName = [&joinedNames](const wxString& name)
+        {
+        if (!joinedNames.empty())
+            { joinedNames += L' '; }
+        joinedNames += name;
+        };
+    // merge the editor's names with the catalog's (both are sorted by key)
+    auto pos = matches.m_names.first;
+    size_t catalogIndex = matches.m_catalogNames.first;
+    std::string_view catalogKey;
+    if (catalogIndex != matches.m_catalogNames.second)
+        { catalogKey = m_catalog->GetKey(wxCodeEditorCatalog::Table::Names, catalogIndex); }
+    const auto nextCatalogName = [this, &matches, &catalogIndex, &catalogKey]()
+        {
+        if (++catalogIndex != matches.m_catalogNames.second)
+            { catalogKey = m_catalog->GetKey(wxCodeEditorCatalog::Table::Names, catalogIndex); }
+        };
+    while (pos != matches.m_names.second || catalogIndex != matches.m_catalogNames.second)
+        {
+        if (catalogIndex == matches.m_catalogNames.second ||
+            (pos != matches.m_names.second && pos->m_key <= catalogKey))
+            {
+            // (a name in both is listed once, as the editor defined it)
+            if (catalogIndex != matches.m_catalogNames.second && pos->m_key == catalogKey)
+                { nextCatalogName(); }
+            appendName(pos->m_name);
+            ++pos;
+            continue;
+            }
+        const std::string_view name = m_catalog->GetValue(wxCodeEditorCatalog::Table::Names, catalogIndex);
+        appendName(wxString::FromUTF8(name.data(), name.length()));
+        nextCatalogName();
+        }
+    return joinedNames;
+    }
+
+const wxString* wxCodeEditor::FindName(const FoldedNameMap& names, const wxCodeEditorCatalog::Table table,
+                                       const wxString& name) const
+    {
+    wxCodeEditorCatalog::FoldKey(name, m_lookupKey);
+    return FindFoldedName(names, table);
+    }
+
+const wxString* wxCodeEditor::FindName(const FoldedNameMap& names, const wxCodeEditorCatalog::Table table,
+                                       const int start, const int end) const
+    {
+    // (the document is stored as UTF-8, and positions are byte offsets into it)
+    if (end > start)
+        {
+        wxCodeEditorCatalog::FoldKey(
+            std::string_view(GetRangePointer(start, end - start), static_cast<size_t>(end - start)), m_lookupKey);
+        }
+    else
+        { m_lookupKey.clear(); }
+    return FindFoldedName(names, table);
+    }
+
+const wxString* wxCodeEditor::FindFoldedName(const FoldedNameMap& names,
+                                             const wxCodeEditorCatalog::Table table) const
+    {
+    const auto pos = names.find(m_lookupKey);
+    if (pos != names.cend())
+        { return &pos->second; }
+    size_t index{ 0 };
+    if (m_catalog != nullptr && m_catalog->FindEntry(table, m_lookupKey, index))
+        {
+        // (usually the same name as last time, e.g., while typing after a library's name)
+        wxString& catalogValue = m_catalogValues[static_cast<size_t>(table)];
+        size_t& catalogValueIndex = m_catalogValueIndices[static_cast<size_t>(table)];
+        if (catalogValueIndex != index)
+            {
+            const std::string_view value = m_catalog->GetValue(table, index);
+            catalogValue = wxString::FromUTF8(value.data(), value.length());
+            catalogValueIndex = index;
+            }
+        return &catalogValue;
+        }
+    return nullptr;
+    }
+
 wxString wxCodeEditor::StripExtraInfo(const wxString& function)
     {
     const int extraInfoStart = function.find_first_of(L"\t (");
@@ -332,16 +515,246 @@ void wxCodeEditor::OnMarginClick(wxStyledTextEvent &event)
         }
     }
 
+void wxCodeEditor::OnModified(wxStyledTextEvent &event)
+    {
+    if (event.GetModificationType() & (wxSTC_MOD_INSERTTEXT|wxSTC_MOD_DELETETEXT))
+        {
+        if (GetLexer() == wxSTC_LEX_LUA)
+            { UpdateAssignmentIndex(LineFromPosition(event.GetPosition()), event.GetLinesAdded()); }
+        ++m_textVersion;
+        // reparse once the user stops typing
+        if (m_backgroundParsing)
+            { m_parseTimer.Start(PARSE_DELAY_MILLISECONDS, wxTIMER_ONE_SHOT); }
+        }
+    // what is code (rather than a string or comment) on the restyled lines may have changed
+    else if ((event.GetModificationType() & wxSTC_MOD_CHANGESTYLE) && GetLexer() == wxSTC_LEX_LUA)
+        {
+        MarkAssignmentLinesStale(LineFromPosition(event.GetPosition()),
+                                 LineFromPosition(event.GetPosition()+event.GetLength()));
+        }
+    event.Skip();
+    }
+
+void wxCodeEditor::OnParseTimer([[maybe_unused]] wxTimerEvent& event)
+    {
+    // (the timer is also started without an edit, e.g., by SetLanguage())
+    if (m_textVersion == m_lastParsedVersion)
+        { return; }
+    m_lastParsedVersion = m_textVersion;
+    m_luaParser.RequestParse(GetText().ToStdWstring(), m_textVersion);
+    }
+
+void wxCodeEditor::ApplyParseResults(wxLuaParser::Results results)
+    {
+    // if the script was edited after this snapshot, then another parse is on its way
+    if (results.m_version != m_textVersion)
+        { return; }
+    m_parseResults = std::move(results);
+
+    SetIndicatorCurrent(PARSE_ERROR_INDICATOR);
+    IndicatorClearRange(0, GetLength());
+    for (const auto& error : m_parseResults.m_errors)
+        {
+        if (error.m_line < GetLineCount())
+            {
+            const int lineStart = PositionFromLine(error.m_line);
+            IndicatorFillRange(lineStart, GetLineEndPosition(error.m_line)-lineStart);
+            }
+        }
+    if (m_parseCallback)
+        { m_parseCallback(m_parseResults); }
+    }
+
+std::vector<wxCodeEditor::Assignment> wxCodeEditor::ParseAssignments(const int line) const
+    {
+    std::vector<Assignment> assignments;
+    // the line in UTF-8, so that offsets into it are document positions
+    const wxCharBuffer lineText = GetLineRaw(line);
+    const std::string_view text(lineText.data(), lineText.length());
+    const int lineStart = PositionFromLine(line);
+    const auto isWordChar = [](const char ch)
+        { return (ch == '_' || (static_cast<unsigned char>(ch) < 0x80 && wxIsalnum(static_cast<wchar_t>(ch)))); };
+    const auto isSpace = [](const char ch)
+        { return ch == ' ' || ch == '\t'; };
+    const auto isCode = [this, lineStart](const size_t offset)
+        {
+        const int style = GetStyleAt(lineStart + static_cast<int>(offset));
+        return (style != wxSTC_LUA_COMMENT && style != wxSTC_LUA_COMMENTLINE && style != wxSTC_LUA_COMMENTDOC &&
+                style != wxSTC_LUA_STRING && style != wxSTC_LUA_CHARACTER && style != wxSTC_LUA_LITERALSTRING &&
+                style != wxSTC_LUA_STRINGEOL);
+        };
+    for (size_t equals = text.find('='); equals != std::string_view::npos; equals = text.find('=', equals+1))
+        {
+        // skip comparisons (==, ~=, <=, >=) and anything in a string or comment
+        if ((equals+1 < text.length() && text[equals+1] == '=') ||
+            (equals > 0 && std::string_view("=~<>").find(text[equals-1]) != std::string_view::npos) ||
+            !isCode(equals))
+            { continue; }
+        size_t variableEnd = equals;
+        while (variableEnd > 0 && isSpace(text[variableEnd-1]))
+            { --variableEnd; }
+        size_t variableStart = variableEnd;
+        while (variableStart > 0 && isWordChar(text[variableStart-1]))
+            { --variableStart; }
+        // a field (e.g., "b" in "a.b = User") isn't a variable of its own
+        if (variableStart > 0 && (text[variableStart-1] == '.' || text[variableStart-1] == ':'))
+            { continue; }
+        size_t valueStart = equals+1;
+        while (valueStart < text.length() && isSpace(text[valueStart]))
+            { ++valueStart; }
+        size_t valueEnd = valueStart;
+        while (valueEnd < text.length() && isWordChar(text[valueEnd]))
+            { ++valueEnd; }
+        if (variableStart < variableEnd && valueStart < valueEnd)
+            {
+            assignments.push_back({ std::string(text.substr(variableStart, variableEnd-variableStart)),
+                                    std::string(text.substr(valueStart, valueEnd-valueStart)),
+                                    static_cast<int>(valueEnd) });
+            }
+        }
+    return assignments;
+    }
+
+void wxCodeEditor::ScanAssignments(const int line)
+    {
+    RemoveVariableAssignments(line);
+    m_lineAssignments[line] = ParseAssignments(line);
+    const auto isBefore = [](const VariableAssignment& first, const VariableAssignment& second)
+        { return std::make_pair(first.m_line, first.m_endOffset) < std::make_pair(second.m_line, second.m_endOffset); };
+    for (const auto& assignment : m_lineAssignments[line])
+        {
+        auto& positions = m_variableAssignments[assignment.m_variable];
+        VariableAssignment position{ line, assignment.m_endOffset, assignment.m_value };
+        const auto insertionPoint = std::upper_bound(positions.begin(), positions.end(), position, isBefore);
+        positions.insert(insertionPoint, std::move(position));
+        }
+    }
+
+void wxCodeEditor::RemoveVariableAssignments(const int line)
+    {
+    for (const auto& assignment : m_lineAssignments[line])
+        {
+        const auto positions = m_variableAssignments.find(assignment.m_variable);
+        if (positions == m_variableAssignments.end())
+            { continue; }
+        auto& variablePositions = positions->second;
+        const auto first = std::lower_bound(variablePositions.begin(), variablePositions.end(), line,
+            [](const VariableAssignment& position, const int value)
+            { return position.m_line < value; });
+        const auto last = std::upper_bound(first, variablePositions.end(), line,
+            [](const int value, const VariableAssignment& position)
+            { return value < position.m_line; });
+        variablePositions.erase(first, last);
+        if (variablePositions.empty())
+            { m_variableAssignments.erase(positions); }
+        }
+    m_lineAssignments[line].clear();
+    }
+
+void wxCodeEditor::UpdateAssignmentIndex(const int firstLine, const int linesAdded)
+    {
+    // the lines (before the edit) that the edit touched
+    const size_t editedLines = 1 + std::max(-linesAdded, 0);
+    if (firstLine < 0 || firstLine+editedLines > m_lineAssignments.size() ||
+        m_lineAssignments.size()+linesAdded != static_cast<size_t>(GetLineCount()))
+        {
+        RebuildAssignmentIndex();
+        return;
+        }
+    if (linesAdded != 0)
+        {
+        for (size_t line = firstLine+1; line < firstLine+editedLines; ++line)
+            { RemoveVariableAssignments(static_cast<int>(line)); }
+        // move the lines after the edit up or down
+        // (this keeps the variables' assignments in order, as none of them were on the removed lines)
+        for (auto& [variable, positions] : m_variableAssignments)
+            {
+            for (auto& position : positions)
+                {
+                if (position.m_line > firstLine)
+                    { position.m_line += linesAdded; }
+                }
+            }
+        std::set<int> staleLines;
+        for (const int line : m_staleAssignmentLines)
+            {
+            if (line <= firstLine)
+                { staleLines.insert(staleLines.end(), line); }
+            else if (line >= firstLine+static_cast<int>(editedLines))
+                { staleLines.insert(staleLines.end(), line+linesAdded); }
+            }
+        m_staleAssignmentLines.swap(staleLines);
+        }
+    if (linesAdded < 0)
+        {
+        m_lineAssignments.erase(m_lineAssignments.begin()+firstLine+1,
+                                m_lineAssignments.begin()+firstLine+editedLines);
+        }
+    else if (linesAdded > 0)
+        { m_lineAssignments.insert(m_lineAssignments.begin()+firstLine+1, linesAdded, std::vector<Assignment>{}); }
+    // (the lexer may not have restyled these lines yet, so they are rescanned when they are needed)
+    MarkAssignmentLinesStale(firstLine, firstLine+std::max(linesAdded, 0));
+    }
+
+void wxCodeEditor::MarkAssignmentLinesStale(const int firstLine, const int lastLine)
+    {
+    // (if the lines are out of step with the script, then it is all rescanned anyway)
+    const int lineCount = static_cast<int>(m_lineAssignments.size());
+    for (int line = std::max(firstLine, 0); line <= std::min(lastLine, lineCount-1); ++line)
+        { m_staleAssignmentLines.insert(m_staleAssignmentLines.end(), line); }
+    }
+
+void wxCodeEditor::RebuildAssignmentIndex()
+    {
+    m_lineAssignments.assign(GetLineCount(), std::vector<Assignment>{});
+    m_variableAssignments.clear();
+    m_staleAssignmentLines.clear();
+    MarkAssignmentLinesStale(0, GetLineCount()-1);
+    }
+
+const wxString* wxCodeEditor::FindAssignedClassFunctions(const int variableStart, const int variableEnd)
+    {
+    if (GetLexer() != wxSTC_LEX_LUA || variableEnd <= variableStart)
+        { return nullptr; }
+    if (m_lineAssignments.size() != static_cast<size_t>(GetLineCount()))
+        { RebuildAssignmentIndex(); }
+    const int variableLine = LineFromPosition(variableStart);
+    const int variableOffset = variableStart - PositionFromLine(variableLine);
+    // strings and comments are told apart by their styles, so make sure that the lexer has caught up
+    // (any lines that this restyles are marked as stale)
+    if (GetEndStyled() < GetLineEndPosition(variableLine))
+        { Colourise(GetEndStyled(), GetLineEndPosition(variableLine)); }
+    // rescan what was edited or restyled since the last lookup, up to where the variable is used
+    while (!m_staleAssignmentLines.empty() && *m_staleAssignmentLines.cbegin() <= variableLine)
+        {
+        const int line = *m_staleAssignmentLines.cbegin();
+        m_staleAssignmentLines.erase(m_staleAssignmentLines.cbegin());
+        ScanAssignments(line);
+        }
+    const wxCharBuffer variable = GetTextRangeRaw(variableStart, variableEnd);
+    const auto positions = m_variableAssignments.find(std::string(variable.data(), variable.length()));
+    if (positions == m_variableAssignments.cend())
+        { return nullptr; }
+    // the last assignment to the variable before it is used here
+    const auto nextAssignment = std::upper_bound(positions->second.cbegin(), positions->second.cend(),
+        std::make_pair(variableLine, variableOffset),
+        [](const std::pair<int, int>& usage, const VariableAssignment& position)
+        { return usage < std::make_pair(position.m_line, position.m_endOffset); });
+    if (nextAssignment == positions->second.cbegin())
+        { return nullptr; }
+    wxCodeEditorCatalog::FoldKey(std::string_view(std::prev(nextAssignment)->m_value), m_lookupKey);
+    return FindFoldedName(m_classCollection, wxCodeEditorCatalog::Table::Classes);
+    }
+
 void wxCodeEditor::OnCharAdded(wxStyledTextEvent &event)
     {
     if (event.GetKey() == GetLibraryAccessor())
         {
         const int wordStart = WordStartPosition(GetCurrentPos()-1, true);
-        const wxString lastWord = GetTextRange(wordStart, GetCurrentPos()-1);
-
-        std::map<wxString,wxString,wxStringCmpNoCase>::const_iterator pos = m_libraryCollection.find(lastWord);
-        if (pos != m_libraryCollection.end())
-            { AutoCompShow(0, pos->second); }
+        const wxString* functions = FindName(m_libraryCollection, wxCodeEditorCatalog::Table::Libraries,
+                                             wordStart, GetCurrentPos()-1);
+        if (functions != nullptr)
+            { AutoCompShow(0, *functions); }
         }
     else if (event.GetKey() == L')' || event.GetKey() == L'(')
         { CallTipCancel(); }
@@ -355,48 +768,23 @@ void wxCodeEditor::OnCharAdded(wxStyledTextEvent &event)
             wordStart = WordStartPosition(wordStart-1, false);
             const wxString functionName = GetTextRange(wordStart, GetCurrentPos()-3);
             wordStart = WordStartPosition(wordStart-1, false);
-            const wxString libraryName = GetTextRange(wordStart, GetCurrentPos()-3);
-            std::map<wxString,wxString,wxStringCmpNoCase>::const_iterator libraryPos = m_libraryFunctionsWithReturnTypes.find(libraryName);
-            if (libraryPos != m_libraryFunctionsWithReturnTypes.end())
+            const wxString* returnType = FindName(m_libraryFunctionsWithReturnTypes,
+                                                  wxCodeEditorCatalog::Table::ReturnTypes,
+                                                  wordStart, GetCurrentPos()-3);
+            if (returnType != nullptr)
                 {
-                libraryPos = m_classCollection.find(libraryPos->second);
-                if (libraryPos != m_classCollection.end())
-                    { AutoCompShow(0, libraryPos->second); }
+                const wxString* functions = FindName(m_classCollection, wxCodeEditorCatalog::Table::Classes, *returnType);
+                if (functions != nullptr)
+                    { AutoCompShow(0, *functions); }
                 }
             }
-        // might be a variable, look for where it was first assigned to something
-        int foundPos = 0;
-        while (foundPos+lastWord.length()+2 < static_cast<size_t>(wordStart))
+        // might be a variable; if it is assigned to a known class of ours,
+        // then show the functions available for that class
+        else
             {
-            foundPos = FindText(foundPos, wordStart, lastWord, wxSTC_FIND_WHOLEWORD|wxSTC_FIND_MATCHCASE);
-            if (foundPos != wxSTC_INVALID_POSITION && foundPos+lastWord.length()+2 < static_cast<size_t>(wordStart))
-                {
-                foundPos += lastWord.length();
-                while (foundPos < GetLength() && GetCharAt(foundPos) == L' ')
-                    { ++foundPos; }
-                // found an assignment to this variable
-                if (foundPos < GetLength() && GetCharAt(foundPos) == L'=')
-                    {
-                    // scan to whatever it is assigned to
-                    do
-                        { ++foundPos; }
-                    while (foundPos < GetLength() && GetCharAt(foundPos) == L' ');
-                    // if it is a known class of ours, then show the functions available for that class
-                    wxString assignment = GetTextRange(foundPos, WordEndPosition(foundPos, true));
-                    std::map<wxString,wxString,wxStringCmpNoCase>::const_iterator classPos = m_classCollection.find(assignment);
-                    if (classPos != m_classCollection.end())
-                        {
-                        AutoCompShow(0, classPos->second);
-                        break;
-                        }
-                    else
-                        { continue; }
-                    }
-                else
-                    { continue; }
-                }
-            else
-                { break; }
+            const wxString* functions = FindAssignedClassFunctions(wordStart, GetCurrentPos()-1);
+            if (functions != nullptr)
+                { AutoCompShow(0, *functions); }
             }
         }
     else
@@ -409,14 +797,14 @@ void wxCodeEditor::OnCharAdded(wxStyledTextEvent &event)
             // see if we are inside a library, if so show its list of functions
             if (wordStart > 2 && GetCharAt(wordStart-1) == GetLibraryAccessor())
                 {
-                const wxString libraryName = GetTextRange(WordStartPosition(wordStart-2, true), wordStart-1);
-                std::map<wxString,wxString,wxStringCmpNoCase>::const_iterator pos = m_libraryCollection.find(libraryName);
-                if (pos != m_libraryCollection.end())
+                const wxString* functions = FindName(m_libraryCollection, wxCodeEditorCatalog::Table::Libraries,
+                                                     WordStartPosition(wordStart-2, true), wordStart-1);
+                if (functions != nullptr)
                     {
                     if (AutoCompActive())
                         { AutoCompSelect(lastWord); }
                     else
-                        { AutoCompShow(lastWord.length(), pos->second); }
+                        { AutoCompShow(lastWord.length(), *functions); }
                     }
                 }
             // if an object...
@@ -431,17 +819,18 @@ void wxCodeEditor::OnCharAdded(wxStyledTextEvent &event)
                     previousWordStart = WordStartPosition(previousWordStart-1, false);
                     const wxString functionName = GetTextRange(previousWordStart, wordStart-1);
                     previousWordStart = WordStartPosition(previousWordStart-1, false);
-                    const wxString libraryName = GetTextRange(previousWordStart, wordStart-1);
-                    std::map<wxString,wxString,wxStringCmpNoCase>::const_iterator libraryPos = m_libraryFunctionsWithReturnTypes.find(libraryName);
-                    if (libraryPos != m_libraryFunctionsWithReturnTypes.end())
+                    const wxString* returnType = FindName(m_libraryFunctionsWithReturnTypes,
+                                                          wxCodeEditorCatalog::Table::ReturnTypes,
+                                                          previousWordStart, wordStart-1);
+                    if (returnType != nullptr)
                         {
-                        libraryPos = m_classCollection.find(libraryPos->second);
-                        if (libraryPos != m_classCollection.end())
+                        const wxString* functions = FindName(m_classCollection, wxCodeEditorCatalog::Table::Classes, *returnType);
+                        if (functions != nullptr)
                             {
                             if (AutoCompActive())
                                 { AutoCompSelect(lastWord); }
                             else
-                                { AutoCompShow(lastWord.length(), libraryPos->second); }
+                                { AutoCompShow(lastWord.length(), *functions); }
                             }
                         }
                     }
@@ -449,16 +838,18 @@ void wxCodeEditor::OnCharAdded(wxStyledTextEvent &event)
             // otherwise, we are at the global level, so show list of high-level classes and libraries
             else
                 {
-                std::set<wxString, wxStringPartialCmpNoCase>::const_iterator pos = m_libaryAndClassNames.find(lastWord);
+                // (a full keyword sorts in front of the longer names that start with it)
+                const NameMatches matches = FindNamesStartingWith(lastWord);
+                const bool found = (matches.m_names.first != matches.m_names.second ||
+                                    matches.m_catalogNames.first != matches.m_catalogNames.second);
                 wxString foundKeyword, params;
-                if (pos != m_libaryAndClassNames.end())
+                if (found)
                     {
-                    foundKeyword = *pos;
+                    foundKeyword = GetFirstName(matches);
                     SplitFunctionAndParams(foundKeyword,params);
                     }
                 // if found a full keyword, then just fix its case and let it auto-highlight
-                if (pos != m_libaryAndClassNames.end() &&
-                    foundKeyword.length() == lastWord.length())
+                if (found && foundKeyword.length() == lastWord.length())
                     {
                     SetSelection(wordStart,wordStart+lastWord.length());
                     // tooltip the parameters (if applicable)
@@ -478,12 +869,13 @@ void wxCodeEditor::OnCharAdded(wxStyledTextEvent &event)
                     AutoCompCancel();
                     }
                 // or if a partial find, then show auto-completion
-                else if (pos != m_libaryAndClassNames.end())
+                else if (found)
                     {
                     if (AutoCompActive())
                         { AutoCompSelect(lastWord); }
+                    // just show the names that can complete the word
                     else
-                        { AutoCompShow(lastWord.length(), m_libaryAndClassNamesStr); }
+                        { AutoCompShow(lastWord.length(), JoinNames(matches)); }
                     }
                 else
                     { AutoCompCancel(); }
@@ -14,9 +14,20 @@
 #include <wx/stc/stc.h>
 #include <wx/validate.h>
 #include <wx/fdrepdlg.h>
-#include <map>
+#include <wx/timer.h>
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <memory>
 #include <set>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
 #include <vector>
+#include "LuaParser.h"
+#include "CodeEditorCatalog.h"
 
 /** @brief A wxStyledTextCtrl-derived editor designed for code editing.
 
@@ -27,8 +38,15 @@
     This editor offers a simplified interface for loading a list of functions and libraries/classes
     (with sub-functions) that will then be recognized by autocompletion and highlighter.
 
+    Large APIs can instead be compiled ahead of time into a wxCodeEditorCatalog, which
+    editors share and read directly from its file (see SetCatalog()).
+
     Also included is built-in file opening and saving support, as well as simplified searching functions.
 
+    Lua scripts are parsed on a background thread shortly after they are edited (see wxLuaParser).
+    Syntax errors are underlined, and the script's functions and assignments are available
+    from GetParseResults() (or SetParseCallback(), to be told when they change).
+
     @par Example:
     @code
     codeEditor = new wxCodeEditor(theParentDlg);
@@ -61,6 +79,8 @@ public:
         @param name The class name for this window.*/
     wxCodeEditor(wxWindow* parent, wxWindowID id=wxID_ANY, const wxPoint& pos=wxDefaultPosition,
                  const wxSize& size=wxDefaultSize, long style=0, const wxString& name=L"wxCodeEditor");
+    /// Destructor, which waits for the background parser to finish.
+    ~wxCodeEditor();
     /** Sets the language used in this editor.
         @param lang The language. `wxSTC_LEX_LUA` is currently supported.*/
     void SetLanguage(const int lang);
@@ -82,6 +102,16 @@ public:
         @param functions The array of functions to add.
         @sa Finalize().*/
     void AddFunctionsOrClasses(const std::vector<wxString>& functions);
+    /** Sets a precompiled catalog of libraries, classes and functions to use for autocompletion
+        and highlighting (along with any added through AddLibrary() and the like).
+        The same catalog can be shared between any number of editors.
+        @param catalog The catalog.
+        @sa Finalize().*/
+    void SetCatalog(std::shared_ptr<const wxCodeEditorCatalog> catalog)
+        {
+        m_catalog = std::move(catalog);
+        m_catalogValueIndices.fill(NO_CATALOG_VALUE);
+        }
     /// Call this after adding all the functions/classes/libraries.
     /// @sa AddFunctionsOrClasses(), AddClass(), AddLibrary().
     void Finalize();
@@ -149,32 +179,166 @@ public:
     /// @returns The file filter used when opening a script.
     const wxString& GetFileFilter() const noexcept
         { return m_fileFilter; }
+
+    /// @returns What the background parser found in the script (as of its last parse).
+    /// @note This is only available when the language is Lua.
+    [[nodiscard]] const wxLuaParser::Results& GetParseResults() const noexcept
+        { return m_parseResults; }
+    /** Sets a function to call (on the UI thread) when the background parser
+        has new results for the script.
+        @param callback The function to call.*/
+    void SetParseCallback(std::function<void(const wxLuaParser::Results&)> callback)
+        { m_parseCallback = std::move(callback); }
 private:
-    struct wxStringCmpNoCase
+    /// Names (folded with wxCodeEditorCatalog::FoldKey(), like the catalog's) and their values.
+    using FoldedNameMap = std::unordered_map<std::string, wxString>;
+    /// A library or class name, along with its key for case-insensitive lookups.
+    struct NameEntry
         {
-        bool operator()(const wxString& s1, const wxString& s2) const
-            { return s1.CmpNoCase(s2) < 0; }
+        /// The name, folded to uppercase (the same way that Scintilla compares autocompletion
+        /// items when ignoring case) with wxCodeEditorCatalog::FoldKey(), so that the editor's
+        /// names sort the same way as the catalog's.
+        std::string m_key;
+        wxString m_name;
         };
-    struct wxStringPartialCmpNoCase
+    using NameRange = std::pair<std::vector<NameEntry>::const_iterator,
+                                std::vector<NameEntry>::const_iterator>;
+    /// Names starting with some text, in the editor's list and in the catalog.
+    struct NameMatches
         {
-        bool operator()(const wxString& s1, const wxString& s2) const
-            { return s1.CmpNoCase(s2.Mid(0,s1.length())) < 0; }
+        NameRange m_names;
+        /// The range of entries in the catalog's names table.
+        std::pair<size_t, size_t> m_catalogNames{ 0, 0 };
         };
 
     static bool SplitFunctionAndParams(wxString& function, wxString& params);
     static wxString StripExtraInfo(const wxString& function);
     static wxString GetReturnType(const wxString& function);
+    /// @returns The libraries and classes whose names start with @c prefix (case insensitively).
+    /// @param prefix The start of the names.
+    /// @warning Finalize() must be called first, as it sorts the names.
+    [[nodiscard]] NameMatches FindNamesStartingWith(const wxString& prefix) const;
+    /// @returns The name that sorts first among some matches (which is the full
+    ///     name, if it was typed), including its parameters if the catalog has them.
+    /// @param matches The names.
+    [[nodiscard]] wxString GetFirstName(const NameMatches& matches) const;
+    /// @returns Names as a sorted list for AutoCompShow().
+    /// @param matches The names to show.
+    [[nodiscard]] wxString JoinNames(const NameMatches& matches) const;
+    /// @returns The value for a name in a map or in the catalog's matching table
+    ///     (compared case insensitively), or null if it isn't in either.
+    ///     (A value from the catalog is valid until the next lookup in that table.)
+    /// @param names The map to search.
+    /// @param table The catalog table to search if the name isn't in the map.
+    /// @param name The name to look for.
+    [[nodiscard]] const wxString* FindName(const FoldedNameMap& names, const wxCodeEditorCatalog::Table table,
+                                           const wxString& name) const;
+    /// @brief Same as the other FindName(), but looks up the text between two positions,
+    ///     folding it straight from the document (rather than copying it into a string first).
+    /// @param names The map to search.
+    /// @param table The catalog table to search if the name isn't in the map.
+    /// @param start The start of the name.
+    /// @param end The end of the name.
+    [[nodiscard]] const wxString* FindName(const FoldedNameMap& names, const wxCodeEditorCatalog::Table table,
+                                           const int start, const int end) const;
+    /// @returns The value for the name folded into @c m_lookupKey (see FindName()).
+    [[nodiscard]] const wxString* FindFoldedName(const FoldedNameMap& names,
+                                                 const wxCodeEditorCatalog::Table table) const;
+
+    /// A variable being assigned something (e.g., `user = User`). The names are in UTF-8.
+    struct Assignment
+        {
+        std::string m_variable;
+        /// The first word of what the variable is assigned to.
+        std::string m_value;
+        /// Where that word ends, in bytes from the start of the line.
+        int m_endOffset{ 0 };
+        };
+    /// Where a variable is assigned something, in the order that the assignments appear in the script.
+    struct VariableAssignment
+        {
+        int m_line{ 0 };
+        /// Where the value ends, in bytes from the start of the line.
+        int m_endOffset{ 0 };
+        std::string m_value;
+        };
+    /// @returns The assignments on a line (skipping any @c = in strings and comments).
+    /// @param line The line to scan.
+    /// @note The line must already be styled by the lexer.
+    [[nodiscard]] std::vector<Assignment> ParseAssignments(const int line) const;
+    /// Rescans a line and updates where its variables are assigned.
+    /// @param line The line to rescan.
+    void ScanAssignments(const int line);
+    /// Removes a line's (previously scanned) assignments from where its variables are assigned.
+    /// @param line The line whose assignments are removed.
+    void RemoveVariableAssignments(const int line);
+    /** @brief Marks the lines touched by an edit as needing to be rescanned.
+        @param firstLine The first line that was edited.
+        @param linesAdded The number of lines that the edit added (or, if negative, removed).*/
+    void UpdateAssignmentIndex(const int firstLine, const int linesAdded);
+    /** @brief Marks lines that the lexer restyled as needing to be rescanned.
+        @details Opening a long comment or string (e.g., typing `--[[`) restyles every line
+            after it, which changes what is code on those lines.
+        @param firstLine The first restyled line.
+        @param lastLine The last restyled line.*/
+    void MarkAssignmentLinesStale(const int firstLine, const int lastLine);
+    /// Marks every line of the script as needing to be rescanned.
+    void RebuildAssignmentIndex();
+    /// @returns The functions of the class that a variable was last assigned to before it is
+    ///     used here, or null if that isn't a known class (or the script isn't Lua).
+    /// @param variableStart The start of the variable.
+    /// @param variableEnd The end of the variable.
+    [[nodiscard]] const wxString* FindAssignedClassFunctions(const int variableStart, const int variableEnd);
 
     void OnMarginClick(wxStyledTextEvent &event);
     void OnCharAdded(wxStyledTextEvent &event);
+    void OnModified(wxStyledTextEvent &event);
+    void OnParseTimer(wxTimerEvent& event);
+    /// Shows the background parser's results, unless the script has been edited since.
+    void ApplyParseResults(wxLuaParser::Results results);
     void OnAutoCompletionSelected(wxStyledTextEvent &event);
     void OnKeyDown(wxKeyEvent& event);
     void OnFind(wxFindDialogEvent &event);
 
-    std::map<wxString, wxString, wxStringCmpNoCase> m_libraryCollection;
-    std::map<wxString, wxString, wxStringCmpNoCase> m_classCollection;
-    std::map<wxString, wxString, wxStringCmpNoCase> m_libraryFunctionsWithReturnTypes;
-    std::set<wxString, wxStringPartialCmpNoCase> m_libaryAndClassNames;
+    FoldedNameMap m_libraryCollection;
+    FoldedNameMap m_classCollection;
+    FoldedNameMap m_libraryFunctionsWithReturnTypes;
+    // scratch buffer for folding names being looked up, in the maps and the catalog
+    // (C++17's unordered_map can only be searched with its own key type)
+    mutable std::string m_lookupKey;
+
+    std::shared_ptr<const wxCodeEditorCatalog> m_catalog;
+    // what was last found in each of the catalog's tables, and the index of its entry
+    // (so that looking the same name up again doesn't convert its value again)
+    static constexpr size_t NO_CATALOG_VALUE{ static_cast<size_t>(-1) };
+    mutable std::array<wxString, static_cast<size_t>(wxCodeEditorCatalog::Table::TABLE_COUNT)> m_catalogValues;
+    // (reset by SetCatalog(), the only way to have a catalog to look anything up in)
+    mutable std::array<size_t, static_cast<size_t>(wxCodeEditorCatalog::Table::TABLE_COUNT)> m_catalogValueIndices{};
+
+    // the assignments on each line of the script (a Lua script), kept in step with its lines as it is edited
+    std::vector<std::vector<Assignment>> m_lineAssignments;
+    // the lines that were edited or restyled since they were last scanned
+    std::set<int> m_staleAssignmentLines;
+    // where each variable is assigned something (sorted by line and offset, for binary searching)
+    std::unordered_map<std::string, std::vector<VariableAssignment>> m_variableAssignments;
+
+    // how long to wait after an edit before reparsing
+    static constexpr int PARSE_DELAY_MILLISECONDS{ 500 };
+    // the indicator for underlining syntax errors
+    static constexpr int PARSE_ERROR_INDICATOR{ 8 };
+    bool m_backgroundParsing{ false };
+    // changes with every edit, so that results for older text can be ignored
+    uint64_t m_textVersion{ 0 };
+    // the version last sent to the parser (none yet)
+    uint64_t m_lastParsedVersion{ static_cast<uint64_t>(-1) };
+    wxTimer m_parseTimer;
+    wxLuaParser::Results m_parseResults;
+    std::function<void(const wxLuaParser::Results&)> m_parseCallback;
+    wxLuaParser m_luaParser;
+    // sorted by key in Finalize(), so that the names starting with some text are contiguous
+    std::vector<NameEntry> m_libaryAndClassNames;
+    // whether names were added since Finalize() last sorted them
+    bool m_namesSorted{ true };
     wxString m_libaryAndClassNamesStr;
 
     wxString m_scriptFilePath;
@@ -186,6 +350,9 @@ private:
     wxChar m_libraryAccessor{ L'.' };
     wxChar m_objectAccessor{ L':' };
 
+    // compiles catalogs the same way that AddLibrary() and the like split up functions
+    friend class wxCodeEditorCatalog;
+
     wxDECLARE_NO_COPY_CLASS(wxCodeEditor);
     wxDECLARE_CLASS(wxCodeEditor);
     wxDECLARE_EVENT_TABLE();
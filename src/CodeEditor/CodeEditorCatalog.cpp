@@ -0,0 +1,484 @@
+/* copyright (c) Oleander Software, Ltd.
+   author: Blake Madden
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the BSD License.
+*/
+
+#include "CodeEditorCatalog.h"
+#include "CodeEditor.h"
+#include <algorithm>
+#include <cstring>
+#ifdef __WXMSW__
+    #include <wx/msw/wrapwin.h>
+#else
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+namespace
+    {
+    // header at the start of a catalog file
+    constexpr char CATALOG_MAGIC[] = { 'W', 'X', 'C', 'E', 'D', 'C', '0', '1' };
+    // written in the compiling machine's byte order, so that a machine
+    // with the other byte order reads it backwards and rejects the file
+    constexpr uint32_t CATALOG_BYTE_ORDER{ 0x01020304 };
+    // the layout of the file (and how its names are folded)
+    constexpr uint32_t CATALOG_VERSION{ 1 };
+    constexpr size_t TABLE_COUNT = static_cast<size_t>(wxCodeEditorCatalog::Table::TABLE_COUNT);
+    // the magic, byte order mark and version, then each table's entry count and offset, the
+    // keywords' offset and length (in the string pool), and the string pool's offset and length
+    constexpr size_t HEADER_LENGTH = sizeof(CATALOG_MAGIC) + sizeof(uint32_t) * (2 + TABLE_COUNT * 2 + 4);
+
+    template<typename T>
+    void AppendValue(std::string& buffer, const T value)
+        { buffer.append(reinterpret_cast<const char*>(&value), sizeof(T)); }
+
+    template<typename T>
+    [[nodiscard]] T ReadValue(const char*& pos)
+        {
+        T value{};
+        std::memcpy(&value, pos, sizeof(T));
+        pos += sizeof(T);
+        return value;
+        }
+
+    [[nodiscard]] std::string ToUTF8(const wxString& text)
+        {
+        const auto textUTF8 = text.utf8_str();
+        return std::string(textUTF8.data(), textUTF8.length());
+        }
+
+    // appends a code point, folded to uppercase, to a key (in UTF-8)
+    void AppendFoldedCodePoint(uint32_t codePoint, std::string& key)
+        {
+        // only code points that fit in a wchar_t can be case mapped; the rest (where wchar_t
+        // is 16 bits) are kept as they are, rather than truncated into some other character
+        if (codePoint <= static_cast<uint32_t>(std::numeric_limits<wchar_t>::max()))
+            { codePoint = static_cast<uint32_t>(wxToupper(codePoint)); }
+        if (codePoint < 0x80)
+            { key += static_cast<char>(codePoint); }
+        else if (codePoint < 0x800)
+            {
+            key += static_cast<char>(0xC0 | (codePoint >> 6));
+            key += static_cast<char>(0x80 | (codePoint & 0x3F));
+            }
+        else if (codePoint < 0x10000)
+            {
+            key += static_cast<char>(0xE0 | (codePoint >> 12));
+            key += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+            key += static_cast<char>(0x80 | (codePoint & 0x3F));
+            }
+        else
+            {
+            key += static_cast<char>(0xF0 | (codePoint >> 18));
+            key += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+            key += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+            key += static_cast<char>(0x80 | (codePoint & 0x3F));
+            }
+        }
+
+    // @returns The function with its parameters (but not its return type),
+    //     or an empty string if it doesn't have parameters.
+    [[nodiscard]] wxString GetFunctionSignature(const wxString& function)
+        {
+        wxString signature = function.BeforeFirst(L'\t');
+        signature.Trim(true); signature.Trim(false);
+        return (signature.find(L'(') != wxString::npos) ? signature : wxString{};
+        }
+    }
+
+void wxCodeEditorCatalog::FoldKey(const wxString& name, std::string& key)
+    {
+    key.clear();
+    // (where wchar_t is 16 bits, code points past 0xFFFF are stored as surrogate pairs)
+    uint32_t highSurrogate{ 0 };
+    for (const wxUniChar ch : name)
+        {
+        const uint32_t value = ch.GetValue();
+        if (highSurrogate != 0 && value >= 0xDC00 && value <= 0xDFFF)
+            {
+            AppendFoldedCodePoint(0x10000 + ((highSurrogate - 0xD800) << 10) + (value - 0xDC00), key);
+            highSurrogate = 0;
+            continue;
+            }
+        if (highSurrogate != 0)
+            { AppendFoldedCodePoint(highSurrogate, key); }
+        highSurrogate = (value >= 0xD800 && value <= 0xDBFF) ? value : 0;
+        if (highSurrogate == 0)
+            { AppendFoldedCodePoint(value, key); }
+        }
+    if (highSurrogate != 0)
+        { AppendFoldedCodePoint(highSurrogate, key); }
+    }
+
+void wxCodeEditorCatalog::FoldKey(const std::string_view nameUTF8, std::string& key)
+    {
+    key.clear();
+    size_t i = 0;
+    while (i < nameUTF8.length())
+        {
+        const auto lead = static_cast<unsigned char>(nameUTF8[i]);
+        const size_t length = (lead < 0x80) ? 1 : ((lead & 0xE0) == 0xC0) ? 2 :
+            ((lead & 0xF0) == 0xE0) ? 3 : ((lead & 0xF8) == 0xF0) ? 4 : 0;
+        bool isValid = (length > 0 && i + length <= nameUTF8.length());
+        uint32_t codePoint = (length == 1) ? lead : (lead & (0x7F >> length));
+        for (size_t j = 1; isValid && j < length; ++j)
+            {
+            const auto next = static_cast<unsigned char>(nameUTF8[i + j]);
+            isValid = ((next & 0xC0) == 0x80);
+            codePoint = (codePoint << 6) | (next & 0x3F);
+            }
+        // (a stray byte is kept as it is)
+        if (!isValid)
+            {
+            key += nameUTF8[i++];
+            continue;
+            }
+        AppendFoldedCodePoint(codePoint, key);
+        i += length;
+        }
+    }
+
+bool wxCodeEditorCatalog::Compile(const Definitions& definitions, const wxString& filePath)
+    {
+    struct PendingEntry
+        {
+        std::string m_key;
+        std::string m_value;
+        std::string m_signature;
+        };
+    std::array<std::vector<PendingEntry>, TABLE_COUNT> tables;
+    std::string key;
+    const auto addEntry = [&tables, &key](const Table table, const wxString& name,
+                                          const wxString& value, const wxString& signature)
+        {
+        FoldKey(name, key);
+        tables[static_cast<size_t>(table)].push_back({ key, ToUTF8(value), ToUTF8(signature) });
+        };
+
+    // split everything up the same way that the editor's AddLibrary() and the like do
+    for (const auto& function : definitions.m_functionsOrClasses)
+        {
+        const wxString name = wxCodeEditor::StripExtraInfo(function);
+        addEntry(Table::Names, name, name, GetFunctionSignature(function));
+        }
+    for (const auto& [library, functions] : definitions.m_libraries)
+        {
+        std::vector<wxString> sortedFunctions(functions);
+        std::sort(sortedFunctions.begin(), sortedFunctions.end());
+        wxString functionString;
+        for (const auto& function : sortedFunctions)
+            {
+            functionString += L" " + wxCodeEditor::StripExtraInfo(function);
+            const wxString returnType = wxCodeEditor::GetReturnType(function);
+            if (returnType.length())
+                {
+                addEntry(Table::ReturnTypes, library+L"."+wxCodeEditor::StripExtraInfo(function),
+                         returnType, wxEmptyString);
+                }
+            }
+        addEntry(Table::Libraries, library, functionString, wxEmptyString);
+        addEntry(Table::Names, library, library, wxEmptyString);
+        }
+    for (const auto& [theClass, functions] : definitions.m_classes)
+        {
+        std::vector<wxString> sortedFunctions(functions);
+        std::sort(sortedFunctions.begin(), sortedFunctions.end());
+        wxString functionString;
+        for (const auto& function : sortedFunctions)
+            { functionString += L" " + wxCodeEditor::StripExtraInfo(function); }
+        addEntry(Table::Classes, theClass, functionString, wxEmptyString);
+        addEntry(Table::Names, theClass, theClass, wxEmptyString);
+        }
+
+    std::string pool;
+    std::string keywords;
+    const auto addString = [&pool](const std::string& text)
+        {
+        const auto offset = static_cast<uint32_t>(pool.length());
+        pool += text;
+        return offset;
+        };
+    std::array<std::string, TABLE_COUNT> tableData;
+    for (size_t i = 0; i < TABLE_COUNT; ++i)
+        {
+        auto& entries = tables[i];
+        // sort by name, keeping the first definition of a name (as the editor does)
+        std::stable_sort(entries.begin(), entries.end(),
+            [](const auto& first, const auto& second)
+            { return first.m_key < second.m_key; });
+        entries.erase(std::unique(entries.begin(), entries.end(),
+            [](const auto& first, const auto& second)
+            { return first.m_key == second.m_key; }),
+            entries.end());
+        for (const auto& entry : entries)
+            {
+            Entry fileEntry;
+            fileEntry.m_keyOffset = addString(entry.m_key);
+            fileEntry.m_keyLength = static_cast<uint32_t>(entry.m_key.length());
+            fileEntry.m_valueOffset = addString(entry.m_value);
+            fileEntry.m_valueLength = static_cast<uint32_t>(entry.m_value.length());
+            fileEntry.m_signatureOffset = addString(entry.m_signature);
+            fileEntry.m_signatureLength = static_cast<uint32_t>(entry.m_signature.length());
+            tableData[i].append(reinterpret_cast<const char*>(&fileEntry), sizeof(Entry));
+            if (static_cast<Table>(i) == Table::Names)
+                {
+                if (!keywords.empty())
+                    { keywords += ' '; }
+                keywords += entry.m_value;
+                }
+            }
+        }
+    const uint32_t keywordsOffset = addString(keywords);
+
+    size_t fileLength = HEADER_LENGTH;
+    for (const auto& data : tableData)
+        { fileLength += data.length(); }
+    // (offsets are 32-bit)
+    if (fileLength + pool.length() > std::numeric_limits<uint32_t>::max())
+        { return false; }
+
+    std::string header(CATALOG_MAGIC, sizeof(CATALOG_MAGIC));
+    AppendValue(header, CATALOG_BYTE_ORDER);
+    AppendValue(header, CATALOG_VERSION);
+    for (const auto& entries : tables)
+        { AppendValue(header, static_cast<uint32_t>(entries.size())); }
+    size_t tableOffset = HEADER_LENGTH;
+    for (const auto& data : tableData)
+        {
+        AppendValue(header, static_cast<uint32_t>(tableOffset));
+        tableOffset += data.length();
+        }
+    AppendValue(header, keywordsOffset);
+    AppendValue(header, static_cast<uint32_t>(keywords.length()));
+    AppendValue(header, static_cast<uint32_t>(fileLength));
+    AppendValue(header, static_cast<uint32_t>(pool.length()));
+
+    wxFile file;
+    if (!file.Create(filePath, true))
+        { return false; }
+    bool written = (file.Write(header.data(), header.length()) == header.length());
+    for (const auto& data : tableData)
+        { written = written && (file.Write(data.data(), data.length()) == data.length()); }
+    written = written && (file.Write(pool.data(), pool.length()) == pool.length());
+    return written && file.Close();
+    }
+
+bool wxCodeEditorCatalog::Load(const wxString& filePath)
+    {
+    Close();
+    if (!Map(filePath) || !ReadHeader())
+        {
+        Close();
+        return false;
+        }
+    return true;
+    }
+
+bool wxCodeEditorCatalog::ReadHeader()
+    {
+    if (m_length < HEADER_LENGTH || std::memcmp(m_data, CATALOG_MAGIC, sizeof(CATALOG_MAGIC)) != 0)
+        { return false; }
+    const char* pos = m_data + sizeof(CATALOG_MAGIC);
+    // (a catalog compiled on a machine with the other byte order, or by another version, can't be read)
+    if (ReadValue<uint32_t>(pos) != CATALOG_BYTE_ORDER || ReadValue<uint32_t>(pos) != CATALOG_VERSION)
+        { return false; }
+    std::array<uint32_t, TABLE_COUNT> entryCounts{}, tableOffsets{};
+    for (auto& entryCount : entryCounts)
+        { entryCount = ReadValue<uint32_t>(pos); }
+    for (auto& tableOffset : tableOffsets)
+        { tableOffset = ReadValue<uint32_t>(pos); }
+    const auto keywordsOffset = ReadValue<uint32_t>(pos);
+    const auto keywordsLength = ReadValue<uint32_t>(pos);
+    const auto poolOffset = ReadValue<uint32_t>(pos);
+    const auto poolLength = ReadValue<uint32_t>(pos);
+
+    // make sure that everything is inside of the file, so that lookups don't have to check
+    if (poolOffset > m_length || poolLength > m_length - poolOffset)
+        { return false; }
+    m_pool = m_data + poolOffset;
+    const auto isInPool = [poolLength](const uint64_t offset, const uint64_t length) noexcept
+        { return offset + length <= poolLength; };
+    if (!isInPool(keywordsOffset, keywordsLength))
+        { return false; }
+    m_keywords = GetPoolString(keywordsOffset, keywordsLength);
+    for (size_t i = 0; i < TABLE_COUNT; ++i)
+        {
+        if (tableOffsets[i] > m_length || entryCounts[i] > (m_length - tableOffsets[i]) / sizeof(Entry))
+            { return false; }
+        m_tables[i] = { m_data + tableOffsets[i], entryCounts[i] };
+        std::string_view previousKey;
+        for (size_t j = 0; j < entryCounts[i]; ++j)
+            {
+            const Entry entry = GetEntry(static_cast<Table>(i), j);
+            if (!isInPool(entry.m_keyOffset, entry.m_keyLength) ||
+                !isInPool(entry.m_valueOffset, entry.m_valueLength) ||
+                !isInPool(entry.m_signatureOffset, entry.m_signatureLength))
+                { return false; }
+            // (the lookups are binary searches)
+            const std::string_view key = GetPoolString(entry.m_keyOffset, entry.m_keyLength);
+            if (j > 0 && key <= previousKey)
+                { return false; }
+            previousKey = key;
+            }
+        }
+    return true;
+    }
+
+wxCodeEditorCatalog::Entry wxCodeEditorCatalog::GetEntry(const Table table, const size_t index) const
+    {
+    Entry entry;
+    std::memcpy(&entry, m_tables[static_cast<size_t>(table)].m_entries + index * sizeof(Entry), sizeof(Entry));
+    return entry;
+    }
+
+std::string_view wxCodeEditorCatalog::GetKey(const Table table, const size_t index) const
+    {
+    const Entry entry = GetEntry(table, index);
+    return GetPoolString(entry.m_keyOffset, entry.m_keyLength);
+    }
+
+std::string_view wxCodeEditorCatalog::GetValue(const Table table, const size_t index) const
+    {
+    const Entry entry = GetEntry(table, index);
+    return GetPoolString(entry.m_valueOffset, entry.m_valueLength);
+    }
+
+std::string_view wxCodeEditorCatalog::GetSignature(const Table table, const size_t index) const
+    {
+    const Entry entry = GetEntry(table, index);
+    return GetPoolString(entry.m_signatureOffset, entry.m_signatureLength);
+    }
+
+size_t wxCodeEditorCatalog::LowerBound(const Table table, const std::string_view key) const
+    {
+    size_t first{ 0 };
+    size_t count = GetEntryCount(table);
+    while (count > 0)
+        {
+        const size_t step = count / 2;
+        if (GetKey(table, first + step) < key)
+            {
+            first += step + 1;
+            count -= step + 1;
+            }
+        else
+            { count = step; }
+        }
+    return first;
+    }
+
+bool wxCodeEditorCatalog::Find(const Table table, const std::string_view key, std::string_view& value) const
+    {
+    size_t index{ 0 };
+    if (!FindEntry(table, key, index))
+        { return false; }
+    value = GetValue(table, index);
+    return true;
+    }
+
+bool wxCodeEditorCatalog::FindEntry(const Table table, const std::string_view key, size_t& index) const
+    {
+    index = LowerBound(table, key);
+    return (index != GetEntryCount(table) && GetKey(table, index) == key);
+    }
+
+std::pair<size_t, size_t> wxCodeEditorCatalog::FindPrefix(const Table table, const std::string_view keyPrefix) const
+    {
+    const size_t first = LowerBound(table, keyPrefix);
+    size_t last = first;
+    while (last < GetEntryCount(table) && GetKey(table, last).substr(0, keyPrefix.length()) == keyPrefix)
+        { ++last; }
+    return std::make_pair(first, last);
+    }
+
+bool wxCodeEditorCatalog::Map(const wxString& filePath)
+    {
+#ifdef __WXMSW__
+    HANDLE fileHandle = ::CreateFileW(filePath.wc_str(), GENERIC_READ, FILE_SHARE_READ|FILE_SHARE_DELETE,
+        nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (fileHandle != INVALID_HANDLE_VALUE)
+        {
+        LARGE_INTEGER fileSize{};
+        if (::GetFileSizeEx(fileHandle, &fileSize) && fileSize.QuadPart > 0)
+            {
+            HANDLE mappingHandle = ::CreateFileMappingW(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (mappingHandle != nullptr)
+                {
+                const void* view = ::MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+                if (view != nullptr)
+                    {
+                    m_fileHandle = fileHandle;
+                    m_mappingHandle = mappingHandle;
+                    m_data = static_cast<const char*>(view);
+                    m_length = static_cast<size_t>(fileSize.QuadPart);
+                    m_mapped = true;
+                    return true;
+                    }
+                ::CloseHandle(mappingHandle);
+                }
+            }
+        ::CloseHandle(fileHandle);
+        }
+#else
+    const int fileDescriptor = ::open(filePath.fn_str(), O_RDONLY);
+    if (fileDescriptor != -1)
+        {
+        struct stat fileInfo{};
+        if (::fstat(fileDescriptor, &fileInfo) == 0 && fileInfo.st_size > 0)
+            {
+            void* view = ::mmap(nullptr, static_cast<size_t>(fileInfo.st_size),
+                                PROT_READ, MAP_SHARED, fileDescriptor, 0);
+            if (view != MAP_FAILED)
+                {
+                // the mapping stays valid after the descriptor is closed
+                ::close(fileDescriptor);
+                m_data = static_cast<const char*>(view);
+                m_length = static_cast<size_t>(fileInfo.st_size);
+                m_mapped = true;
+                return true;
+                }
+            }
+        ::close(fileDescriptor);
+        }
+#endif
+
+    // couldn't map it, so read it instead
+    wxFile file(filePath, wxFile::read);
+    if (!file.IsOpened())
+        { return false; }
+    const wxFileOffset fileLength = file.Length();
+    m_content.resize(fileLength > 0 ? static_cast<size_t>(fileLength) : 0);
+    const ssize_t bytesRead = m_content.empty() ? 0 : file.Read(m_content.data(), m_content.length());
+    if (bytesRead <= 0)
+        { return false; }
+    m_content.resize(static_cast<size_t>(bytesRead));
+    m_data = m_content.data();
+    m_length = m_content.length();
+    return true;
+    }
+
+void wxCodeEditorCatalog::Close()
+    {
+    if (m_mapped)
+        {
+    #ifdef __WXMSW__
+        ::UnmapViewOfFile(m_data);
+        ::CloseHandle(static_cast<HANDLE>(m_mappingHandle));
+        ::CloseHandle(static_cast<HANDLE>(m_fileHandle));
+        m_mappingHandle = m_fileHandle = nullptr;
+    #else
+        ::munmap(const_cast<char*>(m_data), m_length);
+    #endif
+        }
+    m_content.clear();
+    m_content.shrink_to_fit();
+    m_data = nullptr;
+    m_length = 0;
+    m_mapped = false;
+    m_tables = {};
+    m_pool = nullptr;
+    m_keywords = std::string_view{};
+    }
@@ -0,0 +1,201 @@
+/** @addtogroup wxCode
+    @brief A collection of wxWidget tools.
+    @date 2005-2020
+    @copyright Oleander Software, Ltd.
+    @author Blake Madden
+    @details This program is free software; you can redistribute it and/or modify
+    it under the terms of the BSD License.
+* @{*/
+
+#ifndef __WXCODE_EDITOR_CATALOG_H__
+#define __WXCODE_EDITOR_CATALOG_H__
+
+#include <wx/wx.h>
+#include <wx/string.h>
+#include <wx/file.h>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/** @brief A precompiled, memory-mapped catalog of libraries, classes and functions
+        for wxCodeEditor's autocompletion.
+
+    Loading thousands of functions through wxCodeEditor::AddLibrary() and the like sorts
+    and splits them every time an editor is created. Instead, Compile() can do that once
+    (e.g., as a build step) and write the results to a catalog file. Load() maps that file,
+    and editors look names up in it directly, so creating an editor doesn't copy the catalog
+    and any number of editors can share one.
+
+    Each table in the file is an array of entries, sorted by their names folded to uppercase
+    (in UTF-8), so lookups are binary searches over the mapped file.
+
+    @note Numbers are stored in the byte order of the machine that compiled the catalog,
+        so it should be compiled on the same kind of machine that uses it. The header
+        records that byte order (and the catalog format's version), and Load() rejects
+        a catalog that doesn't match.
+
+    @par Example:
+    @code
+    // at build time
+    wxCodeEditorCatalog::Definitions definitions;
+    definitions.m_libraries.push_back({ L"Math", MathFunctions });
+    wxCodeEditorCatalog::Compile(definitions, L"api.catalog");
+
+    // at runtime
+    auto catalog = std::make_shared<wxCodeEditorCatalog>();
+    if (catalog->Load(L"api.catalog"))
+        {
+        codeEditor->SetCatalog(catalog);
+        codeEditor->Finalize();
+        }
+    @endcode*/
+class wxCodeEditorCatalog
+    {
+public:
+    /// @brief The tables in a catalog.
+    enum class Table
+        {
+        /// Top-level functions, libraries and classes, with their signatures.
+        Names,
+        /// Libraries and their (space-separated) functions.
+        Libraries,
+        /// Classes and their (space-separated) functions.
+        Classes,
+        /// Library functions (e.g., @c "Lib.Func") and their return types.
+        ReturnTypes,
+        TABLE_COUNT
+        };
+    /// @brief What to compile into a catalog. The functions use the same syntax as
+    ///     wxCodeEditor::AddLibrary() (e.g., `"GetUser()\tUser"`).
+    struct Definitions
+        {
+        /// Same as wxCodeEditor::AddFunctionsOrClasses().
+        std::vector<wxString> m_functionsOrClasses;
+        /// Libraries and their functions, same as wxCodeEditor::AddLibrary().
+        std::vector<std::pair<wxString, std::vector<wxString>>> m_libraries;
+        /// Classes and their functions, same as wxCodeEditor::AddClass().
+        std::vector<std::pair<wxString, std::vector<wxString>>> m_classes;
+        };
+
+    wxCodeEditorCatalog() = default;
+    /// Destructor, which unmaps the catalog.
+    ~wxCodeEditorCatalog()
+        { Close(); }
+
+    /** @brief Writes a catalog file.
+        @param definitions The libraries, classes and functions to include.
+        @param filePath Where to write the catalog.
+        @returns @c true if the catalog was written.*/
+    static bool Compile(const Definitions& definitions, const wxString& filePath);
+
+    /** @brief Maps a catalog file, closing the previous one (if any).
+        @param filePath The catalog file.
+        @returns @c false if the file couldn't be read or isn't a valid catalog.*/
+    bool Load(const wxString& filePath);
+    /// Unmaps the catalog.
+    void Close();
+    /// @returns @c true if a catalog is loaded.
+    [[nodiscard]] bool IsLoaded() const noexcept
+        { return m_data != nullptr; }
+
+    /** @brief Looks up a name.
+        @param table The table to search.
+        @param key The name, folded with FoldKey().
+        @param[out] value The name's value (e.g., a library's functions).
+        @returns @c true if the name was found.*/
+    bool Find(const Table table, const std::string_view key, std::string_view& value) const;
+    /** @brief Looks up a name's entry.
+        @param table The table to search.
+        @param key The name, folded with FoldKey().
+        @param[out] index The index of the name's entry (see GetValue()).
+        @returns @c true if the name was found.*/
+    bool FindEntry(const Table table, const std::string_view key, size_t& index) const;
+    /// @returns The range of entries whose names start with some text.
+    /// @param table The table to search.
+    /// @param keyPrefix The start of the names, folded with FoldKey().
+    [[nodiscard]] std::pair<size_t, size_t> FindPrefix(const Table table, const std::string_view keyPrefix) const;
+    /// @returns The number of entries in a table.
+    /// @param table The table.
+    [[nodiscard]] size_t GetEntryCount(const Table table) const noexcept
+        { return m_tables[static_cast<size_t>(table)].m_count; }
+    /// @returns An entry's folded name.
+    /// @param table The table.
+    /// @param index The entry's index.
+    [[nodiscard]] std::string_view GetKey(const Table table, const size_t index) const;
+    /// @returns An entry's value. (For the names table, this is the name as it was defined.)
+    /// @param table The table.
+    /// @param index The entry's index.
+    [[nodiscard]] std::string_view GetValue(const Table table, const size_t index) const;
+    /// @returns An entry's signature (e.g., `"SIN(x)"`), or an empty string if it doesn't have one.
+    /// @param table The table.
+    /// @param index The entry's index.
+    [[nodiscard]] std::string_view GetSignature(const Table table, const size_t index) const;
+    /// @returns The (space-separated) names of the libraries, classes and functions, for highlighting.
+    ///     (This is the names table's values, in order.)
+    [[nodiscard]] std::string_view GetKeywords() const noexcept
+        { return m_keywords; }
+
+    /** @brief Folds a name to uppercase UTF-8, which is how names are compared in a catalog.
+        @details Each code point is folded with wxToupper(), except for ones too large for
+            a wchar_t (where it is 16 bits), which are kept as they are.
+        @param name The name to fold.
+        @param[out] key The folded name. (Its buffer is reused, so nothing is
+            allocated once it is large enough.)*/
+    static void FoldKey(const wxString& name, std::string& key);
+    /** @brief Folds a name that is already in UTF-8 (e.g., straight from an editor's document),
+            the same way as the other overload.
+        @param nameUTF8 The name to fold.
+        @param[out] key The folded name.*/
+    static void FoldKey(const std::string_view nameUTF8, std::string& key);
+private:
+    /// An entry in a table. Offsets are into the string pool.
+    struct Entry
+        {
+        uint32_t m_keyOffset{ 0 };
+        uint32_t m_keyLength{ 0 };
+        uint32_t m_valueOffset{ 0 };
+        uint32_t m_valueLength{ 0 };
+        uint32_t m_signatureOffset{ 0 };
+        uint32_t m_signatureLength{ 0 };
+        };
+    /// Where a table is in the mapped file.
+    struct TableView
+        {
+        const char* m_entries{ nullptr };
+        size_t m_count{ 0 };
+        };
+    /// @returns An entry in a table (copied out of the file, which may not be aligned for it).
+    [[nodiscard]] Entry GetEntry(const Table table, const size_t index) const;
+    /// @returns The index of the first entry whose key isn't less than @c key.
+    [[nodiscard]] size_t LowerBound(const Table table, const std::string_view key) const;
+    [[nodiscard]] std::string_view GetPoolString(const uint32_t offset, const uint32_t length) const
+        { return std::string_view(m_pool + offset, length); }
+    /// Maps the file (or reads it, if it can't be mapped).
+    bool Map(const wxString& filePath);
+    /// @returns @c false if the header or any entry points outside of the file.
+    bool ReadHeader();
+
+    const char* m_data{ nullptr };
+    size_t m_length{ 0 };
+    bool m_mapped{ false };
+    // used if the file couldn't be mapped
+    std::string m_content;
+#ifdef __WXMSW__
+    void* m_fileHandle{ nullptr };
+    void* m_mappingHandle{ nullptr };
+#endif
+
+    std::array<TableView, static_cast<size_t>(Table::TABLE_COUNT)> m_tables;
+    const char* m_pool{ nullptr };
+    std::string_view m_keywords;
+
+    wxDECLARE_NO_COPY_CLASS(wxCodeEditorCatalog);
+    };
+
+/** @}*/
+
+#endif //__WXCODE_EDITOR_CATALOG_H__
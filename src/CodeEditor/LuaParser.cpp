@@ -0,0 +1,401 @@
+/* copyright (c) Oleander Software, Ltd.
+   author: Blake Madden
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the BSD License.
+*/
+
+#include "LuaParser.h"
+#include <algorithm>
+
+namespace
+    {
+    [[nodiscard]] constexpr bool IsNameStart(const wchar_t ch) noexcept
+        {
+        return (ch >= L'a' && ch <= L'z') || (ch >= L'A' && ch <= L'Z') ||
+               ch == L'_' || ch >= 0x80;
+        }
+
+    [[nodiscard]] constexpr bool IsNameChar(const wchar_t ch) noexcept
+        { return IsNameStart(ch) || (ch >= L'0' && ch <= L'9'); }
+
+    // @returns The level of the long bracket (e.g., 0 for "[[", 1 for "[=[") at a position,
+    //     or -1 if there isn't one there.
+    [[nodiscard]] int GetLongBracketLevel(const std::wstring_view script, const size_t pos)
+        {
+        if (pos >= script.length() || script[pos] != L'[')
+            { return -1; }
+        size_t end = pos+1;
+        while (end < script.length() && script[end] == L'=')
+            { ++end; }
+        return (end < script.length() && script[end] == L'[') ? static_cast<int>(end-pos-1) : -1;
+        }
+    }
+
+void wxLuaParser::RequestParse(std::wstring script, const uint64_t version)
+    {
+        {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_stopping)
+            { return; }
+        m_pendingScript = std::move(script);
+        m_pendingVersion = version;
+        m_hasPendingScript = true;
+        // the thread is started when it is first needed
+        if (!m_thread.joinable())
+            { m_thread = std::thread(&wxLuaParser::ParseThread, this); }
+        }
+    m_condition.notify_one();
+    }
+
+void wxLuaParser::Stop()
+    {
+        {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+        m_hasPendingScript = false;
+        m_pendingScript.clear();
+        }
+    m_condition.notify_one();
+    if (m_thread.joinable())
+        { m_thread.join(); }
+    }
+
+void wxLuaParser::ParseThread()
+    {
+    for (;;)
+        {
+        std::wstring script;
+        uint64_t version{ 0 };
+            {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_condition.wait(lock, [this]() { return m_stopping || m_hasPendingScript; });
+            if (m_stopping)
+                { return; }
+            script.swap(m_pendingScript);
+            version = m_pendingVersion;
+            m_hasPendingScript = false;
+            }
+        Results results = Parse(script);
+        results.m_version = version;
+        if (m_callback)
+            { m_callback(std::move(results)); }
+        }
+    }
+
+wxLuaParser::Results wxLuaParser::Parse(const std::wstring_view script)
+    {
+    using ErrorType = SyntaxError::Type;
+    struct Block
+        {
+        std::wstring_view m_keyword;
+        int m_line{ 0 };
+        // a "while" or "for" that hasn't reached its "do" yet
+        bool m_awaitingDo{ false };
+        };
+    struct Bracket
+        {
+        wchar_t m_bracket{ 0 };
+        int m_line{ 0 };
+        };
+    constexpr size_t NO_ASSIGNMENT = static_cast<size_t>(-1);
+
+    Results results;
+    std::vector<Block> blocks;
+    std::vector<Bracket> brackets;
+    int line{ 0 };
+    size_t pos{ 0 };
+
+    // what the previous token was, for picking up assignments
+    // (a field keeps the names before it, e.g., "a.b", so that it isn't taken as the variable "b")
+    std::wstring_view previousName;
+    size_t previousNameStart{ 0 };
+    bool previousTokenIsName{ false };
+    bool isLocal{ false };
+    // whether the previous token was a "." after a name (e.g., "a."),
+    // or after something else (e.g., "a[1].", whose field can't be assigned to by name)
+    enum class FieldAccess
+        {
+        None,
+        OfName,
+        OfOther
+        };
+    FieldAccess fieldAccess{ FieldAccess::None };
+    // the assignment whose value is the next token
+    size_t awaitingValue{ NO_ASSIGNMENT };
+    const auto onToken = [&](const bool isName, const std::wstring_view name = std::wstring_view{})
+        {
+        if (awaitingValue != NO_ASSIGNMENT && isName)
+            { results.m_assignments[awaitingValue].m_value = name; }
+        awaitingValue = NO_ASSIGNMENT;
+        previousTokenIsName = isName;
+        previousName = name;
+        fieldAccess = FieldAccess::None;
+        };
+    // moves past a long bracket's closing bracket
+    // @returns false if the closing bracket is missing
+    const auto skipLongBracket = [&](const size_t start, const int level)
+        {
+        const std::wstring closer = L"]" + std::wstring(level, L'=') + L"]";
+        const size_t end = script.find(closer, start);
+        const size_t stop = (end == std::wstring_view::npos) ? script.length() : end+closer.length();
+        line += static_cast<int>(std::count(script.cbegin()+start, script.cbegin()+stop, L'\n'));
+        pos = stop;
+        return (end != std::wstring_view::npos);
+        };
+
+    while (pos < script.length())
+        {
+        const wchar_t ch = script[pos];
+        if (ch == L'\n')
+            {
+            ++line;
+            ++pos;
+            // (a "local" that wasn't followed by an assignment on its line)
+            isLocal = false;
+            }
+        else if (ch == L' ' || ch == L'\t' || ch == L'\r')
+            { ++pos; }
+        // comments
+        else if (ch == L'-' && pos+1 < script.length() && script[pos+1] == L'-')
+            {
+            const int level = GetLongBracketLevel(script, pos+2);
+            if (level >= 0)
+                {
+                const int startLine = line;
+                if (!skipLongBracket(pos+2+level+2, level))
+                    { results.m_errors.push_back({ ErrorType::UnfinishedComment, startLine, L"--[[", startLine }); }
+                }
+            else
+                { pos = std::min(script.find(L'\n', pos), script.length()); }
+            }
+        // strings
+        else if (ch == L'"' || ch == L'\'')
+            {
+            const int startLine = line;
+            bool finished{ false };
+            ++pos;
+            while (pos < script.length() && script[pos] != L'\n')
+                {
+                if (script[pos] == L'\\')
+                    {
+                    // (an escaped newline continues the string, and "\r\n" is one newline)
+                    if (script.compare(pos+1, 2, L"\r\n") == 0)
+                        { ++pos; }
+                    if (pos+1 < script.length() && script[pos+1] == L'\n')
+                        { ++line; }
+                    pos += 2;
+                    continue;
+                    }
+                if (script[pos++] == ch)
+                    {
+                    finished = true;
+                    break;
+                    }
+                }
+            if (!finished)
+                { results.m_errors.push_back({ ErrorType::UnfinishedString, startLine, std::wstring(1, ch), startLine }); }
+            onToken(false);
+            }
+        else if (const int level = GetLongBracketLevel(script, pos); level >= 0)
+            {
+            const int startLine = line;
+            if (!skipLongBracket(pos+level+2, level))
+                { results.m_errors.push_back({ ErrorType::UnfinishedString, startLine, L"[[", startLine }); }
+            onToken(false);
+            }
+        else if (IsNameStart(ch))
+            {
+            const size_t nameStart = pos;
+            while (pos < script.length() && IsNameChar(script[pos]))
+                { ++pos; }
+            const std::wstring_view name = script.substr(nameStart, pos-nameStart);
+            if (name == L"function")
+                {
+                blocks.push_back({ name, line });
+                // read the function's name (if it isn't anonymous), including its library or class
+                while (pos < script.length() && (script[pos] == L' ' || script[pos] == L'\t'))
+                    { ++pos; }
+                const size_t functionStart = pos;
+                while (pos < script.length() &&
+                       (IsNameChar(script[pos]) || script[pos] == L'.' || script[pos] == L':'))
+                    { ++pos; }
+                if (pos > functionStart)
+                    {
+                    results.m_functions.push_back(
+                        { std::wstring(script.substr(functionStart, pos-functionStart)), line, isLocal });
+                    }
+                isLocal = false;
+                onToken(false);
+                }
+            else if (name == L"local")
+                {
+                isLocal = true;
+                onToken(false);
+                }
+            else if (name == L"if" || name == L"repeat")
+                {
+                blocks.push_back({ name, line });
+                onToken(false);
+                }
+            else if (name == L"while" || name == L"for")
+                {
+                blocks.push_back({ name, line, true });
+                onToken(false);
+                }
+            else if (name == L"do")
+                {
+                if (!blocks.empty() && blocks.back().m_awaitingDo)
+                    { blocks.back().m_awaitingDo = false; }
+                else
+                    { blocks.push_back({ name, line }); }
+                onToken(false);
+                }
+            else if (name == L"end")
+                {
+                if (blocks.empty() || blocks.back().m_keyword == L"repeat")
+                    { results.m_errors.push_back({ ErrorType::UnmatchedEnd, line, L"end", line }); }
+                else
+                    {
+                    if (blocks.back().m_awaitingDo)
+                        {
+                        results.m_errors.push_back({ ErrorType::MissingDo, blocks.back().m_line,
+                                                     std::wstring(blocks.back().m_keyword), blocks.back().m_line });
+                        }
+                    blocks.pop_back();
+                    }
+                onToken(false);
+                }
+            else if (name == L"until")
+                {
+                if (!blocks.empty() && blocks.back().m_keyword == L"repeat")
+                    { blocks.pop_back(); }
+                else
+                    { results.m_errors.push_back({ ErrorType::UnmatchedUntil, line, L"until", line }); }
+                onToken(false);
+                }
+            else if (name == L"and" || name == L"break" || name == L"else" || name == L"elseif" ||
+                     name == L"false" || name == L"goto" || name == L"in" || name == L"nil" ||
+                     name == L"not" || name == L"or" || name == L"return" || name == L"then" ||
+                     name == L"true")
+                { onToken(false); }
+            else
+                {
+                const FieldAccess field = fieldAccess;
+                onToken(true, name);
+                if (field == FieldAccess::OfName)
+                    { previousName = script.substr(previousNameStart, pos-previousNameStart); }
+                else if (field == FieldAccess::OfOther)
+                    { previousTokenIsName = false; }
+                else
+                    { previousNameStart = nameStart; }
+                }
+            }
+        // numbers (including hex and exponents)
+        else if (ch >= L'0' && ch <= L'9')
+            {
+            while (pos < script.length() && (IsNameChar(script[pos]) || script[pos] == L'.'))
+                { ++pos; }
+            onToken(false);
+            }
+        else if (ch == L'(' || ch == L'[' || ch == L'{')
+            {
+            brackets.push_back({ ch, line });
+            ++pos;
+            onToken(false);
+            }
+        else if (ch == L')' || ch == L']' || ch == L'}')
+            {
+            const wchar_t opener = (ch == L')') ? L'(' : (ch == L']') ? L'[' : L'{';
+            if (brackets.empty() || brackets.back().m_bracket != opener)
+                { results.m_errors.push_back({ ErrorType::UnmatchedBracket, line, std::wstring(1, ch), line }); }
+            // (a mismatched closer most likely closes the bracket that was left open)
+            if (!brackets.empty())
+                { brackets.pop_back(); }
+            ++pos;
+            onToken(false);
+            }
+        // fields (but not the ".." and "..." operators)
+        else if (ch == L'.')
+            {
+            const size_t dotsStart = pos;
+            while (pos < script.length() && script[pos] == L'.')
+                { ++pos; }
+            const bool isField = (pos-dotsStart == 1);
+            const bool isFieldOfName = (isField && previousTokenIsName);
+            onToken(false);
+            if (isField)
+                { fieldAccess = isFieldOfName ? FieldAccess::OfName : FieldAccess::OfOther; }
+            }
+        // comparisons
+        else if ((ch == L'=' || ch == L'~' || ch == L'<' || ch == L'>') &&
+                 pos+1 < script.length() && script[pos+1] == L'=')
+            {
+            pos += 2;
+            onToken(false);
+            }
+        else if (ch == L'=')
+            {
+            ++pos;
+            if (previousTokenIsName)
+                {
+                results.m_assignments.push_back({ std::wstring(previousName), std::wstring{}, line, isLocal });
+                isLocal = false;
+                onToken(false);
+                awaitingValue = results.m_assignments.size()-1;
+                }
+            else
+                { onToken(false); }
+            }
+        else
+            {
+            ++pos;
+            onToken(false);
+            }
+        }
+
+    // whatever is still open is missing its closer
+    for (const auto& block : blocks)
+        {
+        results.m_errors.push_back({ (block.m_keyword == L"repeat") ? ErrorType::MissingUntil : ErrorType::MissingEnd,
+                                     block.m_line, std::wstring(block.m_keyword), block.m_line });
+        }
+    for (const auto& bracket : brackets)
+        {
+        results.m_errors.push_back({ ErrorType::MissingBracket, bracket.m_line,
+                                     std::wstring(1, bracket.m_bracket), bracket.m_line });
+        }
+    std::stable_sort(results.m_errors.begin(), results.m_errors.end(),
+        [](const auto& first, const auto& second) noexcept
+        { return first.m_line < second.m_line; });
+    return results;
+    }
+
+wxString wxLuaParser::GetErrorMessage(const SyntaxError& error)
+    {
+    switch (error.m_type)
+        {
+        case SyntaxError::Type::UnfinishedString:
+            return _("Unfinished string.");
+        case SyntaxError::Type::UnfinishedComment:
+            return _("Unfinished comment.");
+        case SyntaxError::Type::UnmatchedEnd:
+            return _("'end' does not close a block.");
+        case SyntaxError::Type::MissingEnd:
+            return wxString::Format(_("'end' expected (to close '%s' at line %d)."),
+                                    error.m_token, error.m_openingLine+1);
+        case SyntaxError::Type::MissingDo:
+            return wxString::Format(_("'do' expected after '%s'."), error.m_token);
+        case SyntaxError::Type::UnmatchedUntil:
+            return _("'until' does not close a 'repeat' block.");
+        case SyntaxError::Type::MissingUntil:
+            return wxString::Format(_("'until' expected (to close 'repeat' at line %d)."),
+                                    error.m_openingLine+1);
+        case SyntaxError::Type::UnmatchedBracket:
+            return wxString::Format(_("Unexpected '%s'."), error.m_token);
+        case SyntaxError::Type::MissingBracket:
+            return wxString::Format(_("'%s' is not closed (opened at line %d)."),
+                                    error.m_token, error.m_openingLine+1);
+        default:
+            return wxEmptyString;
+        }
+    }
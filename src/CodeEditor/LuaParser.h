@@ -0,0 +1,146 @@
+/** @addtogroup wxCode
+    @brief A collection of wxWidget tools.
+    @date 2005-2020
+    @copyright Oleander Software, Ltd.
+    @author Blake Madden
+    @details This program is free software; you can redistribute it and/or modify
+    it under the terms of the BSD License.
+* @{*/
+
+#ifndef __WXLUA_PARSER_H__
+#define __WXLUA_PARSER_H__
+
+#include <wx/wx.h>
+#include <wx/string.h>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+/** @brief Scans Lua scripts for their functions, assignments and syntax errors,
+        on a background thread.
+
+    This isn't a full Lua parser; it tokenizes the script (skipping comments and strings)
+    and tracks block and bracket nesting, which is enough to build an outline of the script
+    and to catch most of the mistakes made while typing.
+
+    Scripts are handed to the thread with RequestParse(). If more scripts are requested
+    while one is being parsed, then only the most recent one is parsed next. Results are passed
+    to the callback on the parser's thread, so it should forward them to the UI thread
+    (e.g., with @c CallAfter()).
+
+    @par Example:
+    @code
+    wxLuaParser parser([this](wxLuaParser::Results results)
+        {
+        CallAfter([this, results]() { ShowOutline(results); });
+        });
+    parser.RequestParse(editor->GetText().ToStdWstring(), ++version);
+    @endcode*/
+class wxLuaParser
+    {
+public:
+    /// @brief A function definition.
+    struct Symbol
+        {
+        /// The function's name, including its library or class (e.g., @c "Lib.Func" or @c "Obj:Method").
+        std::wstring m_name;
+        /// The (zero-based) line that it is defined on.
+        int m_line{ 0 };
+        /// @c true if it is a local function.
+        bool m_isLocal{ false };
+        };
+    /// @brief A variable being assigned something.
+    struct Assignment
+        {
+        /// The variable, or a field with the names that lead to it (e.g., @c "a.b").
+        ///     (Fields that are indexed, like @c "a[1].b", aren't included.)
+        std::wstring m_variable;
+        /// The first word of what the variable is assigned to (empty if it isn't a name).
+        std::wstring m_value;
+        /// The (zero-based) line that the assignment is on.
+        int m_line{ 0 };
+        /// @c true if the variable is declared as local.
+        bool m_isLocal{ false };
+        };
+    /// @brief A mistake in the script.
+    struct SyntaxError
+        {
+        /// The kinds of mistakes that are detected.
+        enum class Type
+            {
+            UnfinishedString,
+            UnfinishedComment,
+            UnmatchedEnd,
+            MissingEnd,
+            MissingDo,
+            UnmatchedUntil,
+            MissingUntil,
+            UnmatchedBracket,
+            MissingBracket
+            };
+        Type m_type{ Type::MissingEnd };
+        /// The (zero-based) line that the mistake is on.
+        int m_line{ 0 };
+        /// The keyword or bracket involved.
+        std::wstring m_token;
+        /// For missing closers, the line that the block or bracket was opened on.
+        int m_openingLine{ 0 };
+        };
+    /// @brief What was found in a script.
+    struct Results
+        {
+        /// The version that was passed to RequestParse().
+        uint64_t m_version{ 0 };
+        std::vector<Symbol> m_functions;
+        std::vector<Assignment> m_assignments;
+        std::vector<SyntaxError> m_errors;
+        };
+    /// The callback that receives results (on the parser's thread).
+    using ResultsCallback = std::function<void(Results)>;
+
+    /// @brief Constructor.
+    /// @param callback The function to pass results to.
+    explicit wxLuaParser(ResultsCallback callback) : m_callback(std::move(callback))
+        {}
+    /// @brief Destructor, which waits for the parser's thread to finish.
+    ~wxLuaParser()
+        { Stop(); }
+
+    /** @brief Queues a script to be parsed, replacing any script that is still waiting.
+        @param script The text of the script.
+        @param version A number identifying this version of the script, which is
+            included in its results.*/
+    void RequestParse(std::wstring script, const uint64_t version);
+    /// @brief Stops the parser's thread (discarding any script that is waiting).
+    void Stop();
+
+    /// @returns What was found in a script.
+    /// @param script The text of the script.
+    [[nodiscard]] static Results Parse(const std::wstring_view script);
+    /// @returns A description of a syntax error, for showing to the user.
+    /// @param error The error.
+    [[nodiscard]] static wxString GetErrorMessage(const SyntaxError& error);
+private:
+    void ParseThread();
+
+    ResultsCallback m_callback;
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    // the most recent script that was requested (and not parsed yet)
+    std::wstring m_pendingScript;
+    uint64_t m_pendingVersion{ 0 };
+    bool m_hasPendingScript{ false };
+    bool m_stopping{ false };
+
+    wxDECLARE_NO_COPY_CLASS(wxLuaParser);
+    };
+
+/** @}*/
+
+#endif //__WXLUA_PARSER_H__
@@ -1,94 +1,2519 @@
 #include "LogFile.h"
+#include <csignal>
+#ifdef __WXMSW__
+    #include <wx/msw/wrapwin.h>
+    #include <io.h>
+    #include <fcntl.h>
+    #include <sys/stat.h>
+    #include <climits>
+#else
+    #include <unistd.h>
+    #include <fcntl.h>
+    #include <sys/file.h>
+    #include <cerrno>
+#endif
 
-wxLogFile::wxLogFile()
+namespace
     {
-    m_logFilePath = wxStandardPaths::Get().GetTempDir() + wxFileName::GetPathSeparator() +
+    // header at the start of a binary log file
+    constexpr char BINARY_LOG_MAGIC[] = { 'W', 'X', 'L', 'O', 'G', 'B', '0', '1' };
+    // record types in a binary log file
+    constexpr char RECORD_STRING = 'S'; // function or file name definition
+    constexpr char RECORD_FULL = 'R';   // message logged with its call site information
+    constexpr char RECORD_LEVEL_TEXT = 'L'; // message logged at a level, without call site information
+    constexpr char RECORD_TEXT = 'T';   // plain message
+
+    template<typename T>
+    void AppendValue(std::string& buffer, const T value)
+        { buffer.append(reinterpret_cast<const char*>(&value), sizeof(T)); }
+
+    template<typename T>
+    [[nodiscard]] bool ReadValue(const char*& pos, const char* end, T& value)
+        {
+        if (static_cast<size_t>(end - pos) < sizeof(T))
+            { return false; }
+        std::memcpy(&value, pos, sizeof(T));
+        pos += sizeof(T);
+        return true;
+        }
+
+    [[nodiscard]] bool ReadBytes(const char*& pos, const char* end, const char*& str, uint32_t& length)
+        {
+        if (!ReadValue(pos, end, length) || static_cast<size_t>(end - pos) < length)
+            { return false; }
+        str = pos;
+        pos += length;
+        return true;
+        }
+
+    // appends a string as UTF-8, without creating a temporary buffer
+    void AppendUTF8(std::string& buffer, const wxString& str)
+        {
+    #if wxUSE_UNICODE_UTF8
+        buffer.append(str.wx_str(), std::strlen(str.wx_str()));
+    #else
+        const wchar_t* const chars = str.wc_str();
+        const size_t length = str.length();
+        for (size_t i = 0; i < length; ++i)
+            {
+            uint32_t codePoint = static_cast<uint32_t>(chars[i]);
+            if (codePoint < 0x80)
+                {
+                buffer += static_cast<char>(codePoint);
+                continue;
+                }
+            // combine UTF-16 surrogate pairs (where wchar_t is 16-bit)
+            if (codePoint >= 0xD800 && codePoint <= 0xDBFF && i + 1 < length &&
+                chars[i + 1] >= 0xDC00 && chars[i + 1] <= 0xDFFF)
+                {
+                codePoint = 0x10000 + ((codePoint - 0xD800) << 10) +
+                    (static_cast<uint32_t>(chars[++i]) - 0xDC00);
+                }
+            else if ((codePoint >= 0xD800 && codePoint <= 0xDFFF) || codePoint > 0x10FFFF)
+                { codePoint = 0xFFFD; }
+
+            if (codePoint < 0x800)
+                {
+                buffer += static_cast<char>(0xC0 | (codePoint >> 6));
+                buffer += static_cast<char>(0x80 | (codePoint & 0x3F));
+                }
+            else if (codePoint < 0x10000)
+                {
+                buffer += static_cast<char>(0xE0 | (codePoint >> 12));
+                buffer += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+                buffer += static_cast<char>(0x80 | (codePoint & 0x3F));
+                }
+            else
+                {
+                buffer += static_cast<char>(0xF0 | (codePoint >> 18));
+                buffer += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+                buffer += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+                buffer += static_cast<char>(0x80 | (codePoint & 0x3F));
+                }
+            }
+    #endif
+        }
+
+    // appends a string as UTF-8, preceded by its length
+    void AppendSizedUTF8(std::string& buffer, const wxString& str)
+        {
+        // reserve room for the length, and fill it in once the string is encoded
+        const size_t lengthPos = buffer.length();
+        AppendValue(buffer, uint32_t{ 0 });
+        AppendUTF8(buffer, str);
+        const uint32_t length = static_cast<uint32_t>(buffer.length() - lengthPos - sizeof(uint32_t));
+        std::memcpy(&buffer[lengthPos], &length, sizeof(length));
+        }
+
+    // appends a text record's message: records end with a bare LF, so line breaks in the
+    // message are written as CRLF (and any at the end of it are dropped, as the record ends there)
+    void AppendMessageUTF8(std::string& buffer, const wxString& msg)
+        {
+        const size_t messageStart = buffer.length();
+        AppendUTF8(buffer, msg);
+        while (buffer.length() > messageStart && (buffer.back() == '\n' || buffer.back() == '\r'))
+            { buffer.pop_back(); }
+        if (std::memchr(buffer.data() + messageStart, '\n', buffer.length() - messageStart) == nullptr)
+            { return; }
+        const std::string message(buffer, messageStart, std::string::npos);
+        buffer.resize(messageStart);
+        for (size_t i = 0; i < message.length(); ++i)
+            {
+            if (message[i] == '\n' && (i == 0 || message[i - 1] != '\r'))
+                { buffer += '\r'; }
+            buffer += message[i];
+            }
+        }
+
+    // the same as AppendMessageUTF8(), for a message being rendered as text
+    wxString FormatMessageLines(const wxString& msg)
+        {
+        size_t length = msg.length();
+        while (length > 0 && (msg[length - 1] == L'\n' || msg[length - 1] == L'\r'))
+            { --length; }
+        wxString message;
+        message.reserve(length);
+        for (size_t i = 0; i < length; ++i)
+            {
+            if (msg[i] == L'\n' && (i == 0 || msg[i - 1] != L'\r'))
+                { message += L'\r'; }
+            message += msg[i];
+            }
+        return message;
+        }
+
+    // reads the full (undecoded) content of a file
+    bool ReadFileBytes(const wxString& filePath, std::string& content)
+        {
+        wxFile file(filePath, wxFile::read);
+        if (!file.IsOpened())
+            { return false; }
+        const wxFileOffset fileLength = file.Length();
+        content.resize(fileLength > 0 ? static_cast<size_t>(fileLength) : 0);
+        const ssize_t bytesRead = content.empty() ? 0 : file.Read(content.data(), content.length());
+        content.resize(bytesRead > 0 ? static_cast<size_t>(bytesRead) : 0);
+        return true;
+        }
+
+    // header at the start of a crash ring file, followed by the ring itself
+    constexpr char CRASH_RING_MAGIC[] = { 'W', 'X', 'L', 'O', 'G', 'R', '0', '1' };
+    constexpr size_t CRASH_RING_HEADER_SIZE = 4096;
+    struct CrashRingHeader
+        {
+        char m_magic[sizeof(CRASH_RING_MAGIC)]{};
+        // size of the ring (after the header)
+        uint64_t m_capacity{ 0 };
+        // how much has ever been written to the ring
+        uint64_t m_writePosition{ 0 };
+        // everything written before this is in the log file
+        uint64_t m_flushedPosition{ 0 };
+        uint32_t m_recordFormat{ 0 };
+        // the log file that the ring belongs to (in UTF-8)
+        uint32_t m_logFilePathLength{ 0 };
+        char m_logFilePath[CRASH_RING_HEADER_SIZE - 40]{};
+        };
+    static_assert(sizeof(CrashRingHeader) == CRASH_RING_HEADER_SIZE,
+                  "The crash ring header should fill its space exactly.");
+
+    // appends a quoted JSON string (from UTF-8 text)
+    void AppendJSONString(std::string& buffer, const char* str, const size_t length)
+        {
+        constexpr char HEX_DIGITS[] = "0123456789abcdef";
+        buffer += '"';
+        for (size_t i = 0; i < length; ++i)
+            {
+            const auto ch = static_cast<unsigned char>(str[i]);
+            if (ch == '"' || ch == '\\')
+                {
+                buffer += '\\';
+                buffer += static_cast<char>(ch);
+                }
+            else if (ch < 0x20)
+                {
+                buffer += "\\u00";
+                buffer += HEX_DIGITS[ch >> 4];
+                buffer += HEX_DIGITS[ch & 0xF];
+                }
+            else
+                { buffer += static_cast<char>(ch); }
+            }
+        buffer += '"';
+        }
+
+    template<typename T>
+    void AppendNumber(std::string& buffer, const T value)
+        {
+        char digits[32]{};
+        const auto result = std::to_chars(std::begin(digits), std::end(digits), value);
+        buffer.append(digits, result.ptr);
+        }
+
+    // signals that the emergency flush writes the unwritten records for
+    constexpr int FATAL_SIGNALS[] =
+        {
+        SIGSEGV, SIGABRT, SIGFPE, SIGILL,
+    #ifndef __WXMSW__
+        SIGBUS
+    #endif
+        };
+    // the handlers that were installed before the emergency flush's
+#ifdef __WXMSW__
+    using SignalHandler = void (*)(int);
+    SignalHandler previousSignalHandlers[std::size(FATAL_SIGNALS)]{};
+#else
+    struct sigaction previousSignalActions[std::size(FATAL_SIGNALS)]{};
+#endif
+
+    void InstallFatalSignalHandlers(void (*handler)(int))
+        {
+        for (size_t i = 0; i < std::size(FATAL_SIGNALS); ++i)
+            {
+        #ifdef __WXMSW__
+            previousSignalHandlers[i] = std::signal(FATAL_SIGNALS[i], handler);
+        #else
+            struct sigaction action{};
+            action.sa_handler = handler;
+            sigemptyset(&action.sa_mask);
+            ::sigaction(FATAL_SIGNALS[i], &action, &previousSignalActions[i]);
+        #endif
+            }
+        }
+
+    // puts back the handler for a signal (or all of them, if signalNumber is 0)
+    // (async-signal-safe, as this is also called from the signal handler)
+    void RestoreFatalSignalHandlers(const int signalNumber = 0) noexcept
+        {
+        for (size_t i = 0; i < std::size(FATAL_SIGNALS); ++i)
+            {
+            if (signalNumber != 0 && FATAL_SIGNALS[i] != signalNumber)
+                { continue; }
+        #ifdef __WXMSW__
+            std::signal(FATAL_SIGNALS[i], previousSignalHandlers[i]);
+        #else
+            ::sigaction(FATAL_SIGNALS[i], &previousSignalActions[i], nullptr);
+        #endif
+            }
+        }
+
+    // writes all of the data, unless the descriptor fails (async-signal-safe)
+    void WriteToDescriptor(const int fileDescriptor, const char* data, size_t length) noexcept
+        {
+        while (length > 0)
+            {
+        #ifdef __WXMSW__
+            const int written = ::_write(fileDescriptor, data,
+                                         static_cast<unsigned int>(std::min<size_t>(length, INT_MAX)));
+        #else
+            const ssize_t written = ::write(fileDescriptor, data, length);
+            if (written < 0 && errno == EINTR)
+                { continue; }
+        #endif
+            if (written <= 0)
+                { return; }
+            data += written;
+            length -= static_cast<size_t>(written);
+            }
+        }
+
+    int DuplicateDescriptor(const int fileDescriptor) noexcept
+        {
+    #ifdef __WXMSW__
+        return ::_dup(fileDescriptor);
+    #else
+        return ::dup(fileDescriptor);
+    #endif
+        }
+
+    void CloseDescriptor(const int fileDescriptor) noexcept
+        {
+        if (fileDescriptor == -1)
+            { return; }
+    #ifdef __WXMSW__
+        ::_close(fileDescriptor);
+    #else
+        ::close(fileDescriptor);
+    #endif
+        }
+
+    // opens (or creates) a file and locks it, so that no other process can lock it until
+    // the descriptor is closed (or the process ends, even if it crashes)
+    // @returns The descriptor, or -1 if the file is locked by someone else (or couldn't be opened).
+    int LockFileExclusively(const wxString& filePath) noexcept
+        {
+    #ifdef __WXMSW__
+        const int fileDescriptor = ::_wopen(filePath.wc_str(), _O_RDWR|_O_CREAT|_O_BINARY,
+                                            _S_IREAD|_S_IWRITE);
+        if (fileDescriptor == -1)
+            { return -1; }
+        OVERLAPPED overlapped{};
+        if (!::LockFileEx(reinterpret_cast<HANDLE>(::_get_osfhandle(fileDescriptor)),
+                          LOCKFILE_EXCLUSIVE_LOCK|LOCKFILE_FAIL_IMMEDIATELY, 0, 1, 0, &overlapped))
+    #else
+        const int fileDescriptor = ::open(filePath.fn_str(), O_RDWR|O_CREAT, 0644);
+        if (fileDescriptor == -1)
+            { return -1; }
+        if (::flock(fileDescriptor, LOCK_EX|LOCK_NB) != 0)
+    #endif
+            {
+            CloseDescriptor(fileDescriptor);
+            return -1;
+            }
+        return fileDescriptor;
+        }
+
+    // appends nanoseconds as (fractional) microseconds, which is what trace_event uses
+    void AppendMicroseconds(std::string& buffer, const int64_t nanoseconds)
+        {
+        const int64_t value = std::max<int64_t>(nanoseconds, 0);
+        AppendNumber(buffer, value / 1000);
+        const auto fraction = static_cast<int>(value % 1000);
+        buffer += '.';
+        buffer += static_cast<char>('0' + (fraction / 100));
+        buffer += static_cast<char>('0' + ((fraction / 10) % 10));
+        buffer += static_cast<char>('0' + (fraction % 10));
+        }
+    }
+
+wxString wxLogFile::GetDefaultLogFilePath()
+    {
+    return wxStandardPaths::Get().GetTempDir() + wxFileName::GetPathSeparator() +
         wxTheApp->GetAppName() + wxDateTime::Now().FormatISODate() + L".log";
-    wxFile logFile;
-    if (!logFile.Create(m_logFilePath, true))
+    }
+
+wxString wxLogFile::GetDefaultCrashRingPath()
+    {
+    // not dated, so that it is found even if the crashed session was on another day
+    return wxStandardPaths::Get().GetTempDir() + wxFileName::GetPathSeparator() +
+        wxTheApp->GetAppName() + L".logring";
+    }
+
+wxLogFile::wxLogFile(const wxString& logFilePath) :
+    wxLogFile(logFilePath, wxFileName(logFilePath).GetPathWithSep() + wxFileName(logFilePath).GetName() + L".logring")
+    {}
+
+wxLogFile::wxLogFile(const wxString& logFilePath, const wxString& crashRingPath) :
+    m_crashRingPath(crashRingPath), m_logFilePath(logFilePath)
+    {
+    // save anything that a crashed session didn't get to write before its log file is cleared
+    // (the log file itself is cleared and created on the first flush)
+    RecoverCrashRing();
+    if (!m_recoveredLogFilePath.empty())
         {
-        wxMessageBox(wxString::Format(_("Unable to create log file at '%s'"), m_logFilePath),
-            _("Logging Error"), wxOK|wxICON_WARNING);
+        StagingBuffer& staging = GetStagingBuffer();
+        std::lock_guard<std::mutex> lock(staging.m_mutex);
+        AppendNotice(staging, wxLOG_Warning, std::time(nullptr),
+            wxString::Format(_("The previous session ended unexpectedly; its log was recovered to '%s'."),
+                             m_recoveredLogFilePath));
         }
-    else
+    }
+
+wxLogFile::~wxLogFile()
+    {
+    // log the records still held for sampling
+    std::vector<std::shared_ptr<StagingBuffer>> buffers;
+        {
+        std::lock_guard<std::mutex> lock(m_stagingBuffersMutex);
+        buffers = m_stagingBuffers;
+        }
+    for (auto& buffer : buffers)
+        {
+        std::lock_guard<std::mutex> lock(buffer->m_mutex);
+        ReleaseSampledRecords(*buffer, true);
+        }
+    wxLogFile::Flush();
+    wxString errorMessage;
+        {
+        std::lock_guard<std::mutex> flushLock(m_flushMutex);
+        StopWriterThread(errorMessage);
+        }
+    if (!errorMessage.empty())
+        { ReportError(errorMessage); }
+    if (m_hasUnsyncedData && m_syncPolicy != SyncPolicy::Never)
+        { m_logFile.Flush(); }
+    // finish compressing the rotated files
+    if (m_compressionThread.joinable())
+        {
+            {
+            std::lock_guard<std::mutex> lock(m_compressionMutex);
+            m_stopCompression = true;
+            }
+        m_compressionQueued.notify_one();
+        m_compressionThread.join();
+        }
+    // everything made it into the log file, so there is nothing to recover
+    EnableCrashRing(false);
+    EnableEmergencyFlush(false);
+    std::lock_guard<std::mutex> flushLock(m_flushMutex);
+    for (auto& sink : m_sinks)
+        { sink->Flush(); }
+    }
+
+std::string wxLogFile::ReadLogBytes()
+    {
+    FlushAndWait();
+
+    std::string logBuffer;
+    // flushing to temp file failed somehow (or there's a previous session's file
+    // that wasn't replaced yet), so return whatever is queued up at least
+    if (m_logFilePending || !ReadFileBytes(m_logFilePath, logBuffer))
         {
-        // clear file (from a previous program run) and prepare for appending
-        logFile.Write(wxEmptyString);
+        std::lock_guard<std::mutex> flushLock(m_flushMutex);
+        logBuffer = m_buffer;
         }
+    return logBuffer;
     }
 
 wxString wxLogFile::ReadLog()
     {
+    const std::string logBuffer = ReadLogBytes();
+    if (m_recordFormat == RecordFormat::Binary)
+        { return RenderBinaryLog(logBuffer.data(), logBuffer.length()); }
+    return wxString::FromUTF8(logBuffer.data(), logBuffer.length());
+    }
+
+std::string wxLogFile::ReadLogUTF8()
+    {
+    std::string logBuffer = ReadLogBytes();
+    if (m_recordFormat == RecordFormat::Binary)
+        {
+        const wxString renderedLog = RenderBinaryLog(logBuffer.data(), logBuffer.length());
+        logBuffer.clear();
+        AppendUTF8(logBuffer, renderedLog);
+        }
+    return logBuffer;
+    }
+
+bool wxLogFile::ExportLog(const wxString& filePath)
+    {
+    // the text is already UTF-8, so write it without converting it to a wxString and back
+    const std::string logText = ReadLogUTF8();
+    wxFile exportFile;
+    return exportFile.Create(filePath, true) &&
+        exportFile.Write(logText.data(), logText.length()) == logText.length();
+    }
+
+void wxLogFile::SetRecordFormat(const RecordFormat format)
+    {
+    if (format == m_recordFormat)
+        { return; }
+    // write anything logged in the old format, then start the file over
     wxLogFile::Flush();
+    WaitUntilWritten();
+
+    std::lock_guard<std::mutex> flushLock(m_flushMutex);
+        {
+        std::lock_guard<std::mutex> definitionsLock(m_stringDefinitionsMutex);
+        m_recordFormat = format;
+        m_internedStrings.clear();
+        // invalidates the IDs that the threads have cached
+        ++m_internGeneration;
+        m_pendingDefinitions.clear();
+        m_stringDefinitions.clear();
+        }
+    // records are formatted with the staging buffer locked, so once every buffer has been
+    // merged, anything logged from here on is in the new format; discard anything logged
+    // in the old format since the flush (along with a block that the writer thread couldn't write)
+    MergeStagingBuffers();
+    ClearBuffer();
+        {
+        std::lock_guard<std::mutex> queueLock(m_queueMutex);
+        m_writeQueue.clear();
+        m_failedBlocks = 0;
+        }
+    // the crash ring is recovered in the format that its header names, so retag it and
+    // treat what is in it as written (the records in the old format were either written
+    // or discarded above, and any logged since the merge are only missing from the ring)
+        {
+        std::lock_guard<std::mutex> ringLock(m_crashRingMutex);
+        char* mappedData = m_crashRing.GetWritableData();
+        if (mappedData != nullptr)
+            {
+            auto* header = reinterpret_cast<CrashRingHeader*>(mappedData);
+            header->m_recordFormat = static_cast<uint32_t>(format);
+            header->m_flushedPosition = header->m_writePosition;
+            }
+        }
+    std::lock_guard<std::mutex> lock(m_fileMutex);
+    m_logFile.Close();
+    // started over with the next write (with a binary header, if needed)
+    m_logFilePending = true;
+    }
+
+void wxLogFile::SetRotation(const wxFileOffset maxFileSize, const long intervalSeconds /*= 0*/,
+                            const size_t keptGenerations /*= 5*/)
+    {
+    std::lock_guard<std::mutex> lock(m_fileMutex);
+    m_rotationFileSize = std::max<wxFileOffset>(maxFileSize, 0);
+    m_rotationInterval = std::chrono::seconds(std::max(intervalSeconds, 0L));
+    m_rotationGenerations = keptGenerations;
+    }
+
+bool wxLogFile::CreateLogFile()
+    {
+    m_logFileSize = 0;
+    m_partialBlockLength = 0;
+    m_logFileCreated = std::chrono::steady_clock::now();
+    // delete the old file instead of truncating it, as a reader may still have it mapped
+    // (and reading mapped pages past the end of a truncated file faults)
+    if (wxFileName::FileExists(m_logFilePath))
+        { wxRemoveFile(m_logFilePath); }
+    if (!m_logFile.Create(m_logFilePath, true))
+        { return false; }
+    if (m_recordFormat == RecordFormat::Binary)
+        {
+        // the records in the new file may refer to functions and files that were
+        // defined in an earlier file, so include all of the definitions
+        std::string preamble(BINARY_LOG_MAGIC, sizeof(BINARY_LOG_MAGIC));
+            {
+            std::lock_guard<std::mutex> definitionsLock(m_stringDefinitionsMutex);
+            preamble += m_stringDefinitions;
+            }
+        m_logFile.Write(preamble.data(), preamble.length());
+        m_logFileSize = static_cast<wxFileOffset>(preamble.length());
+        if (m_searchIndexEnabled)
+            {
+            m_searchIndex.Open(GetSearchIndexPath(), true);
+            m_searchIndex.AddRecords(preamble, {}, 0, true);
+            }
+        }
+    else if (m_searchIndexEnabled)
+        { m_searchIndex.Open(GetSearchIndexPath(), true); }
+    return true;
+    }
+
+bool wxLogFile::EnableSearchIndex(const bool enable /*= true*/)
+    {
+    std::lock_guard<std::mutex> flushLock(m_flushMutex);
+    std::lock_guard<std::mutex> lock(m_fileMutex);
+    if (!enable)
+        {
+        m_searchIndexEnabled = false;
+        m_searchIndex.Close();
+        return true;
+        }
+    if (m_searchIndexEnabled)
+        { return true; }
+    if (!m_searchIndex.Open(GetSearchIndexPath(), true))
+        { return false; }
+    // records written from here on may refer to function and file names defined earlier
+    if (m_recordFormat == RecordFormat::Binary)
+        {
+        std::lock_guard<std::mutex> definitionsLock(m_stringDefinitionsMutex);
+        m_searchIndex.AddRecords(m_stringDefinitions, {}, 0, true);
+        }
+    m_searchIndexEnabled = true;
+    return true;
+    }
+
+std::vector<wxLogFileIndex::Match> wxLogFile::SearchAll(const wxLogFileIndex::Query& query) const
+    {
+    size_t generations{ 0 };
+        {
+        std::lock_guard<std::mutex> lock(m_fileMutex);
+        generations = m_rotationGenerations;
+        }
+    std::vector<wxLogFileIndex::Match> matches;
+        {
+        std::lock_guard<std::mutex> generationsLock(m_generationsMutex);
+        for (size_t generation = generations; generation >= 1; --generation)
+            {
+            for (const auto offset : wxLogFileIndex::FindInFile(GetRotatedSearchIndexPath(generation), query))
+                { matches.push_back({ generation, offset }); }
+            }
+        }
+    for (const auto offset : m_searchIndex.Find(query))
+        { matches.push_back({ 0, offset }); }
+    return matches;
+    }
+
+bool wxLogFile::IsRotationDue(const size_t incomingBytes) const
+    {
+    if (m_logFileSize == 0)
+        { return false; }
+    return ((m_rotationFileSize > 0 &&
+             m_logFileSize + static_cast<wxFileOffset>(incomingBytes) > m_rotationFileSize) ||
+            (m_rotationInterval.count() > 0 &&
+             std::chrono::steady_clock::now() - m_logFileCreated >= m_rotationInterval));
+    }
+
+void wxLogFile::RotateLogFile()
+    {
+    if (m_hasUnsyncedData && m_syncPolicy != SyncPolicy::Never)
+        { m_logFile.Flush(); }
+    m_hasUnsyncedData = false;
+    m_logFile.Close();
 
-    wxString logBuffer;
-    wxFile logFile(m_logFilePath, wxFile::read);
-    if (logFile.IsOpened())
-        { logFile.ReadAll(&logBuffer); }
-    // flushing to temp file failed somehow,
-    // so return whatever is queued up at least
+    if (m_rotationGenerations == 0)
+        { wxRemoveFile(m_logFilePath); }
     else
-        { return m_buffer; }
-    return logBuffer;
+        {
+        // move the file out of the way and let the compression thread compress it and shift the
+        // generations, so that rotating never waits on an earlier rotation's compression
+        const wxString uncompressedPath = m_logFilePath +
+            wxString::Format(L".%llu.rotated", static_cast<unsigned long long>(++m_rotationCount));
+        if (wxRenameFile(m_logFilePath, uncompressedPath))
+            {
+            // the rotated file's index goes with it (the new log file starts a new one)
+            if (m_searchIndexEnabled)
+                {
+                m_searchIndex.Close();
+                wxRenameFile(GetSearchIndexPath(), uncompressedPath + L".idx");
+                }
+            QueueCompression(uncompressedPath);
+            }
+        }
+
+    // if this fails, then it will be tried again with the next write
+    m_logFilePending = true;
+    wxString errorMessage;
+    OpenLogFile(errorMessage);
+    }
+
+void wxLogFile::QueueCompression(const wxString& uncompressedPath)
+    {
+        {
+        std::lock_guard<std::mutex> lock(m_compressionMutex);
+        m_compressionQueue.push_back({ uncompressedPath, m_rotationGenerations });
+        if (!m_compressionThread.joinable())
+            { m_compressionThread = std::thread(&wxLogFile::CompressionThreadMain, this); }
+        }
+    m_compressionQueued.notify_one();
+    }
+
+void wxLogFile::CompressionThreadMain()
+    {
+    std::unique_lock<std::mutex> lock(m_compressionMutex);
+    for (;;)
+        {
+        m_compressionQueued.wait(lock,
+            [this]() { return m_stopCompression || !m_compressionQueue.empty(); });
+        // compress everything before honoring a stop request
+        if (m_compressionQueue.empty())
+            { break; }
+        const RotatedFile rotatedFile = m_compressionQueue.front();
+        m_compressionQueue.pop_front();
+        lock.unlock();
+        CompressRotatedFile(rotatedFile);
+        lock.lock();
+        }
+    }
+
+void wxLogFile::CompressRotatedFile(const RotatedFile& rotatedFile)
+    {
+    // the generations are only shifted once the file is compressed, so the first
+    // generation is never a partly written file
+    const wxString compressedPath = rotatedFile.m_path + L".gz";
+    if (!CompressFile(rotatedFile.m_path, compressedPath))
+        {
+        // leave the uncompressed file, rather than losing it
+        if (wxFileName::FileExists(rotatedFile.m_path))
+            { wxRemoveFile(compressedPath); }
+        return;
+        }
+    // compact its index (if it has one), so that searching it doesn't load the index into memory
+    const wxString indexPath = rotatedFile.m_path + L".idx";
+    const wxString compactedIndexPath = compressedPath + L".idx";
+    bool hasIndex{ false };
+    if (wxFileName::FileExists(indexPath))
+        {
+        hasIndex = wxLogFileIndex::Compact(indexPath, compactedIndexPath);
+        wxRemoveFile(indexPath);
+        if (!hasIndex && wxFileName::FileExists(compactedIndexPath))
+            { wxRemoveFile(compactedIndexPath); }
+        }
+
+    std::lock_guard<std::mutex> generationsLock(m_generationsMutex);
+    // drop the oldest generation and shift the rest up by one
+    for (size_t generation = rotatedFile.m_keptGenerations; generation >= 1; --generation)
+        {
+        const wxString rotatedPaths[] = { GetRotatedLogFilePath(generation),
+                                          GetRotatedSearchIndexPath(generation) };
+        const wxString shiftedPaths[] = { GetRotatedLogFilePath(generation + 1),
+                                          GetRotatedSearchIndexPath(generation + 1) };
+        for (size_t i = 0; i < std::size(rotatedPaths); ++i)
+            {
+            if (!wxFileName::FileExists(rotatedPaths[i]))
+                { continue; }
+            if (generation == rotatedFile.m_keptGenerations)
+                { wxRemoveFile(rotatedPaths[i]); }
+            else
+                { wxRenameFile(rotatedPaths[i], shiftedPaths[i]); }
+            }
+        }
+    wxRenameFile(compressedPath, GetRotatedLogFilePath(1));
+    if (hasIndex)
+        { wxRenameFile(compactedIndexPath, GetRotatedSearchIndexPath(1)); }
+    }
+
+bool wxLogFile::CompressFile(const wxString& sourcePath, const wxString& destinationPath)
+    {
+        {
+        wxFileInputStream input(sourcePath);
+        wxFileOutputStream output(destinationPath);
+        if (!input.IsOk() || !output.IsOk())
+            { return false; }
+        wxZlibOutputStream compressedOutput(output, wxZ_DEFAULT_COMPRESSION, wxZLIB_GZIP);
+        compressedOutput.Write(input);
+        if (!compressedOutput.Close() || !output.Close())
+            { return false; }
+        }
+    return wxRemoveFile(sourcePath);
     }
 
 void wxLogFile::Flush()
     {
     wxLog::Flush();
-    if (m_buffer.length())
+    FlushPending();
+    }
+
+void wxLogFile::FlushPending()
+    {
+    wxString errorMessage;
+        {
+        std::lock_guard<std::mutex> flushLock(m_flushMutex);
+        // everything written to the crash ring before this is in the staging buffers being merged
+        const uint64_t crashRingPosition = GetCrashRingPosition();
+        const uint64_t emergencyPosition = GetEmergencyPosition();
+        MergeStagingBuffers();
+        if (m_hasSinks)
+            { SendToSinks(); }
+        // (the first flush creates the file, even if there's nothing to write yet)
+        if (m_buffer.length() || m_logFilePending)
+            {
+            if (m_asyncWriting)
+                {
+                PendingBlock block{ std::move(m_buffer), m_bufferHasError, crashRingPosition,
+                                    emergencyPosition, std::move(m_bufferRecords) };
+                ClearBuffer();
+                std::unique_lock<std::mutex> lock(m_queueMutex);
+                // apply back pressure if the writer thread has fallen behind
+                // (a block that it couldn't write is waiting on this one, so it doesn't count)
+                m_queueNotFull.wait(lock,
+                    [this]() { return m_writeQueue.size() - m_failedBlocks < m_maxQueuedBlocks; });
+                m_writeQueue.push_back(std::move(block));
+                // reuse the memory from a block that was already written
+                m_buffer.swap(m_recycledBuffer);
+                lock.unlock();
+                m_queueNotEmpty.notify_one();
+                }
+            // if the write fails, then leave it queued and try again on the next flush
+            else if (WriteBlock(m_buffer, m_bufferHasError, m_bufferRecords, errorMessage))
+                {
+                // clearing (instead of reallocating) keeps the buffer's memory for the next batch
+                ClearBuffer();
+                MarkCrashRingFlushed(crashRingPosition);
+                MarkEmergencyBufferWritten(emergencyPosition);
+                }
+            }
+        else if (!m_asyncWriting)
+            {
+            SyncIfDue();
+            MarkCrashRingFlushed(crashRingPosition);
+            MarkEmergencyBufferWritten(emergencyPosition);
+            }
+        }
+    // (reported after the flush mutex is unlocked, as the handler may log something,
+    // which flushes again if the high-water mark is reached)
+    if (!errorMessage.empty())
+        { ReportError(errorMessage); }
+    }
+
+void wxLogFile::ClearBuffer()
+    {
+    m_buffer.clear();
+    m_bufferHasError = false;
+    m_bufferRecords.clear();
+    m_sentBufferLength = m_sentBufferRecords = 0;
+    }
+
+void wxLogFile::SendToSinks()
+    {
+    // (if an earlier write failed, then part of the buffer was already sent)
+    if (m_buffer.length() <= m_sentBufferLength)
+        { return; }
+    auto batch = std::make_shared<wxLogFileBatch>();
+    batch->m_binary = (m_recordFormat == RecordFormat::Binary);
+    batch->m_data.assign(m_buffer, m_sentBufferLength, std::string::npos);
+    batch->m_records.assign(m_bufferRecords.cbegin() + m_sentBufferRecords, m_bufferRecords.cend());
+    for (auto& record : batch->m_records)
+        { record.m_offset -= m_sentBufferLength; }
+    m_sentBufferLength = m_buffer.length();
+    m_sentBufferRecords = m_bufferRecords.size();
+
+    const std::shared_ptr<const wxLogFileBatch> sharedBatch{ std::move(batch) };
+    for (auto& sink : m_sinks)
+        { sink->Write(sharedBatch); }
+    }
+
+void wxLogFile::AddSink(std::shared_ptr<wxLogFileSink> sink)
+    {
+    if (!sink)
+        { return; }
+    std::lock_guard<std::mutex> flushLock(m_flushMutex);
+    if (m_recordFormat == RecordFormat::Binary)
         {
-        wxFile logFile(m_logFilePath, wxFile::write_append);
-        if (logFile.IsOpened())
+        // give the sink everything that it needs to decode the records that follow
+        auto header = std::make_shared<wxLogFileBatch>();
+        header->m_binary = true;
+        header->m_data.assign(BINARY_LOG_MAGIC, sizeof(BINARY_LOG_MAGIC));
             {
-            logFile.Write(m_buffer);
-            m_buffer.clear();
+            std::lock_guard<std::mutex> definitionsLock(m_stringDefinitionsMutex);
+            header->m_data += m_stringDefinitions;
             }
+        sink->Write(header);
         }
+    m_sinks.push_back(std::move(sink));
+    m_hasSinks = true;
     }
 
-void wxLogFile::DoLogTextAtLevel(wxLogLevel level, const wxString &msg)
+void wxLogFile::RemoveSink(const std::shared_ptr<wxLogFileSink>& sink)
     {
-    wxString prefix;
-    switch (level)
+    std::lock_guard<std::mutex> flushLock(m_flushMutex);
+    const auto sinkPos = std::find(m_sinks.begin(), m_sinks.end(), sink);
+    if (sinkPos == m_sinks.end())
+        { return; }
+    (*sinkPos)->Flush();
+    m_sinks.erase(sinkPos);
+    m_hasSinks = !m_sinks.empty();
+    }
+
+bool wxLogFile::WriteBlock(const std::string& data, const bool hasError,
+                           const std::vector<wxLogFileBatch::Record>& records,
+                           wxString& errorMessage)
+    {
+    uint64_t fileOffset{ 0 };
+    const bool written = WriteBlockToFile(data, hasError, fileOffset, errorMessage);
+    // (indexed after the file is unlocked, so that tokenizing the records doesn't hold up
+    // other writes; only one thread writes blocks at a time, so they are indexed in order)
+    if (written && m_searchIndexEnabled)
+        { m_searchIndex.AddRecords(data, records, fileOffset, m_recordFormat == RecordFormat::Binary); }
+    return written;
+    }
+
+void wxLogFile::ReportError(const wxString& errorMessage)
+    {
+    ErrorHandler handler;
         {
-        case wxLOG_Debug:
-            [[fallthrough]];
-        case wxLOG_Trace:
-            prefix = L"Debug: ";
-            break;
-        case wxLOG_FatalError: 
-            [[fallthrough]];
-        case wxLOG_Error:
-            prefix = L"Error: ";
-            break;
-        case wxLOG_Warning:
-            prefix = L"Warning: ";
+        std::lock_guard<std::mutex> lock(m_errorMutex);
+        m_lastError = errorMessage;
+        handler = m_errorHandler;
         }
-    m_buffer += (prefix + msg);
+    if (handler)
+        { handler(errorMessage); }
     }
 
-void wxLogFile::DoLogRecord(wxLogLevel level, const wxString &msg, const wxLogRecordInfo &info)
+bool wxLogFile::OpenLogFile(wxString& errorMessage)
     {
-    wxString prefix;
-    switch (level)
+    if (m_logFilePending)
         {
-        case wxLOG_Debug:
-            [[fallthrough]];
-        case wxLOG_Trace:
-            prefix = L"Debug: ";
-            break;
-        case wxLOG_FatalError: 
-            [[fallthrough]];
-        case wxLOG_Error:
-            prefix = L"Error: ";
-            break;
-        case wxLOG_Warning:
-            prefix = L"Warning: ";
-        }
-    m_buffer += wxString::Format(L"%s%s\t%s\t%s\t%s: line %d\n",
-        prefix, msg,
-        wxDateTime(info.timestamp).FormatISOCombined(' '),
-        (info.func ? wxString(info.func) : L"NA"),
-        (info.filename ? wxFileName(info.filename).GetFullName() : L"NA"),
-        info.line);
+        // clear the file (from a previous program run) and keep it open for appending
+        if (!CreateLogFile())
+            {
+            if (!m_fileErrorReported)
+                {
+                errorMessage = wxString::Format(_("Unable to create log file at '%s'"), m_logFilePath);
+                m_fileErrorReported = true;
+                }
+            return false;
+            }
+        m_logFilePending = false;
+        UpdateEmergencyFileDescriptor();
+        }
+    // if the file was closed, then try to reopen it
+    else if (!m_logFile.IsOpened())
+        {
+        if (!m_logFile.Open(m_logFilePath, wxFile::write_append))
+            {
+            if (!m_fileErrorReported)
+                {
+                errorMessage = wxString::Format(_("Unable to open log file at '%s'"), m_logFilePath);
+                m_fileErrorReported = true;
+                }
+            return false;
+            }
+        m_logFileSize = m_logFile.Length();
+        UpdateEmergencyFileDescriptor();
+        }
+    return true;
+    }
+
+bool wxLogFile::WriteBlockToFile(const std::string& data, const bool hasError,
+                                 uint64_t& fileOffset, wxString& errorMessage)
+    {
+    std::lock_guard<std::mutex> lock(m_fileMutex);
+    if (!OpenLogFile(errorMessage))
+        { return false; }
+    if (data.empty())
+        { return true; }
+
+    if (IsRotationDue(data.length()))
+        { RotateLogFile(); }
+    if (!OpenLogFile(errorMessage))
+        { return false; }
+
+    const auto writeStart = std::chrono::steady_clock::now();
+    // pick up where a partial write of this block left off, so nothing is written twice
+    const size_t alreadyWritten = std::min(m_partialBlockLength, data.length());
+    fileOffset = static_cast<uint64_t>(m_logFileSize) - alreadyWritten;
+    size_t written = alreadyWritten;
+    while (written < data.length())
+        {
+        const size_t count = m_logFile.Write(data.data() + written, data.length() - written);
+        if (count == 0)
+            { break; }
+        written += count;
+        }
+    m_logFileSize += static_cast<wxFileOffset>(written - alreadyWritten);
+    if (written != data.length())
+        {
+        m_partialBlockLength = written;
+        m_hasUnsyncedData = m_hasUnsyncedData || (written > alreadyWritten);
+        if (!m_fileErrorReported)
+            {
+            errorMessage = wxString::Format(_("Unable to write to log file '%s'"), m_logFilePath);
+            m_fileErrorReported = true;
+            }
+        return false;
+        }
+    m_partialBlockLength = 0;
+    m_fileErrorReported = false;
+    m_hasUnsyncedData = true;
+
+    const auto now = std::chrono::steady_clock::now();
+    const SyncPolicy syncPolicy = m_syncPolicy;
+    if ((syncPolicy == SyncPolicy::OnError && hasError) ||
+        (syncPolicy == SyncPolicy::Interval && now - m_lastSync >= m_syncInterval.load()))
+        {
+        m_logFile.Flush();
+        m_lastSync = now;
+        m_hasUnsyncedData = false;
+        }
+
+    RecordFlushLatency(std::chrono::steady_clock::now() - writeStart);
+        {
+        std::lock_guard<std::mutex> statisticsLock(m_statisticsMutex);
+        m_bytesWritten += data.length() - alreadyWritten;
+        ++m_flushCount;
+        }
+    return true;
+    }
+
+void wxLogFile::SyncIfDue()
+    {
+    std::lock_guard<std::mutex> lock(m_fileMutex);
+    const auto now = std::chrono::steady_clock::now();
+    if (m_hasUnsyncedData && m_syncPolicy == SyncPolicy::Interval &&
+        now - m_lastSync >= m_syncInterval.load() && m_logFile.IsOpened())
+        {
+        m_logFile.Flush();
+        m_lastSync = now;
+        m_hasUnsyncedData = false;
+        }
+    }
+
+void wxLogFile::EnableAsyncWriting(const bool enable, const size_t maxQueuedBlocks /*= 64*/)
+    {
+    wxString errorMessage;
+        {
+        // locked so that a flush (e.g., from a worker thread reaching the high-water mark)
+        // can't queue a block while the writer thread is starting or stopping
+        std::lock_guard<std::mutex> flushLock(m_flushMutex);
+        if (enable)
+            {
+                {
+                std::lock_guard<std::mutex> lock(m_queueMutex);
+                m_maxQueuedBlocks = std::max<size_t>(maxQueuedBlocks, 1);
+                }
+            if (!m_asyncWriting)
+                {
+                m_stopWriter = false;
+                m_writerThread = std::thread(&wxLogFile::WriterThreadMain, this);
+                m_asyncWriting = true;
+                }
+            }
+        else if (m_asyncWriting)
+            { StopWriterThread(errorMessage); }
+        }
+    if (!errorMessage.empty())
+        { ReportError(errorMessage); }
+    }
+
+void wxLogFile::WaitUntilWritten()
+    {
+    if (!m_asyncWriting)
+        { return; }
+    std::unique_lock<std::mutex> lock(m_queueMutex);
+    m_queueDrained.wait(lock,
+        [this]() { return m_writeQueue.size() <= m_failedBlocks && !m_writingBlock; });
+    }
+
+void wxLogFile::StopWriterThread(wxString& errorMessage)
+    {
+    if (!m_writerThread.joinable())
+        { return; }
+        {
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+        m_stopWriter = true;
+        }
+    m_queueNotEmpty.notify_one();
+    m_writerThread.join();
+    m_asyncWriting = false;
+
+    std::unique_lock<std::mutex> lock(m_queueMutex);
+    if (m_writeQueue.empty())
+        { return; }
+    PendingBlock block = TakeQueuedBlocks();
+    m_failedBlocks = 0;
+    lock.unlock();
+
+    // put the block back in front of anything merged since, where a synchronous flush
+    // leaves the records that it couldn't write (it was already sent to the sinks)
+    for (auto& record : m_bufferRecords)
+        { record.m_offset += block.m_data.length(); }
+    m_bufferRecords.insert(m_bufferRecords.begin(), block.m_records.cbegin(), block.m_records.cend());
+    m_buffer.insert(0, block.m_data);
+    m_bufferHasError = m_bufferHasError || block.m_hasError;
+    m_sentBufferLength += block.m_data.length();
+    m_sentBufferRecords += block.m_records.size();
+    if (WriteBlock(m_buffer, m_bufferHasError, m_bufferRecords, errorMessage))
+        {
+        ClearBuffer();
+        MarkCrashRingFlushed(block.m_crashRingPosition);
+        MarkEmergencyBufferWritten(block.m_emergencyPosition);
+        }
+    }
+
+wxLogFile::PendingBlock wxLogFile::TakeQueuedBlocks()
+    {
+    PendingBlock block = std::move(m_writeQueue.front());
+    m_writeQueue.pop_front();
+    while (!m_writeQueue.empty())
+        {
+        for (auto record : m_writeQueue.front().m_records)
+            {
+            record.m_offset += block.m_data.length();
+            block.m_records.push_back(record);
+            }
+        block.m_data += m_writeQueue.front().m_data;
+        block.m_hasError = block.m_hasError || m_writeQueue.front().m_hasError;
+        block.m_crashRingPosition = m_writeQueue.front().m_crashRingPosition;
+        block.m_emergencyPosition = m_writeQueue.front().m_emergencyPosition;
+        m_writeQueue.pop_front();
+        }
+    return block;
+    }
+
+void wxLogFile::WriterThreadMain()
+    {
+    std::unique_lock<std::mutex> lock(m_queueMutex);
+    for (;;)
+        {
+        const auto hasWork = [this]()
+            { return m_stopWriter || m_writeQueue.size() > m_failedBlocks; };
+        // if syncing on an interval, wake up periodically to sync anything written earlier
+        // (the policy can be changed while waiting, so it is read once here)
+        const auto syncInterval = m_syncInterval.load();
+        if (m_syncPolicy == SyncPolicy::Interval && syncInterval.count() > 0)
+            {
+            if (!m_queueNotEmpty.wait_for(lock, syncInterval, hasWork))
+                {
+                lock.unlock();
+                SyncIfDue();
+                lock.lock();
+                continue;
+                }
+            }
+        else
+            { m_queueNotEmpty.wait(lock, hasWork); }
+        // drain everything before honoring a stop request so that nothing is lost
+        // (a block that still can't be written is left for StopWriterThread())
+        if (m_writeQueue.size() <= m_failedBlocks)
+            { break; }
+        // group everything that is queued up into one write
+        PendingBlock block = TakeQueuedBlocks();
+        m_writingBlock = true;
+        lock.unlock();
+        m_queueNotFull.notify_all();
+
+        wxString errorMessage;
+        const bool written = WriteBlock(block.m_data, block.m_hasError, block.m_records, errorMessage);
+        if (written)
+            {
+            MarkCrashRingFlushed(block.m_crashRingPosition);
+            MarkEmergencyBufferWritten(block.m_emergencyPosition);
+            }
+        if (!errorMessage.empty())
+            { ReportError(errorMessage); }
+
+        lock.lock();
+        m_writingBlock = false;
+        if (written)
+            {
+            m_failedBlocks = 0;
+            // hand the memory back to Flush() for the next batch
+            if (block.m_data.capacity() > m_recycledBuffer.capacity())
+                {
+                block.m_data.clear();
+                m_recycledBuffer.swap(block.m_data);
+                }
+            }
+        else
+            {
+            // leave it queued (ahead of anything queued since) and try again along with the
+            // next block, the same as a synchronous flush leaves it for the next flush
+            m_writeQueue.push_front(std::move(block));
+            m_failedBlocks = 1;
+            }
+        if (m_writeQueue.size() <= m_failedBlocks)
+            { m_queueDrained.notify_all(); }
+        }
+    }
+
+const char* wxLogFile::GetLevelPrefix(const wxLogLevel level) noexcept
+    {
+    switch (level)
+        {
+        case wxLOG_Debug:
+            [[fallthrough]];
+        case wxLOG_Trace:
+            return "Debug: ";
+        case wxLOG_FatalError:
+            [[fallthrough]];
+        case wxLOG_Error:
+            return "Error: ";
+        case wxLOG_Warning:
+            return "Warning: ";
+        default:
+            return "";
+        }
+    }
+
+wxString wxLogFile::FormatRecord(const wxLogLevel level, const wxString& msg,
+                                 const time_t timestamp, const wxString& func,
+                                 const wxString& fileName, const int line)
+    {
+    return wxString::Format(L"%s%s\t%s\t%s\t%s: line %d\n",
+        GetLevelPrefix(level), FormatMessageLines(msg),
+        wxDateTime(timestamp).FormatISOCombined(' '),
+        func, fileName, line);
+    }
+
+const std::string& wxLogFile::StagingBuffer::GetTimestampText(const time_t timestamp)
+    {
+    if (timestamp != m_cachedTimestamp || m_cachedTimestampText.empty())
+        {
+        m_cachedTimestamp = timestamp;
+        m_cachedTimestampText.clear();
+        AppendUTF8(m_cachedTimestampText, wxDateTime(timestamp).FormatISOCombined(' '));
+        }
+    return m_cachedTimestampText;
+    }
+
+const std::string& wxLogFile::StagingBuffer::GetCachedFileName(const char* filePath)
+    {
+    const auto [pos, inserted] = m_fileNameCache.try_emplace(filePath);
+    if (inserted)
+        { AppendUTF8(pos->second, wxFileName(filePath).GetFullName()); }
+    return pos->second;
+    }
+
+const std::string& wxLogFile::StagingBuffer::GetCachedFunctionName(const char* func)
+    {
+    const auto [pos, inserted] = m_functionNameCache.try_emplace(func);
+    if (inserted)
+        { AppendUTF8(pos->second, wxString(func)); }
+    return pos->second;
+    }
+
+void wxLogFile::AppendTextRecord(StagingBuffer& staging, const wxLogLevel level,
+                                 const wxString& msg, const wxLogRecordInfo& info)
+    {
+    std::string& buffer = staging.m_data;
+    buffer += GetLevelPrefix(level);
+    AppendMessageUTF8(buffer, msg);
+    buffer += '\t';
+    buffer += staging.GetTimestampText(info.timestamp);
+    buffer += '\t';
+    buffer += (info.func ? staging.GetCachedFunctionName(info.func).c_str() : "NA");
+    buffer += '\t';
+    buffer += (info.filename ? staging.GetCachedFileName(info.filename).c_str() : "NA");
+    buffer += ": line ";
+    char lineNumber[16]{ 0 };
+    const auto [lineNumberEnd, errorCode] =
+        std::to_chars(std::begin(lineNumber), std::end(lineNumber), info.line);
+    if (errorCode == std::errc())
+        { buffer.append(lineNumber, lineNumberEnd); }
+    buffer += '\n';
+    }
+
+uint32_t wxLogFile::InternString(StagingBuffer& staging, const char* str)
+    {
+    if (str == nullptr)
+        { return 0; }
+    // the IDs are cached by each thread so that the shared table is rarely locked
+    const uint64_t internGeneration = m_internGeneration;
+    if (staging.m_internGeneration != internGeneration)
+        {
+        staging.m_internedIds.clear();
+        staging.m_internGeneration = internGeneration;
+        }
+    const auto cachedPos = staging.m_internedIds.find(str);
+    if (cachedPos != staging.m_internedIds.cend())
+        { return cachedPos->second; }
+
+    std::lock_guard<std::mutex> definitionsLock(m_stringDefinitionsMutex);
+    const auto [pos, inserted] =
+        m_internedStrings.try_emplace(str, static_cast<uint32_t>(m_internedStrings.size() + 1));
+    if (inserted)
+        {
+        // the definition is written ahead of the merged records that refer to it
+        const uint32_t length = static_cast<uint32_t>(std::strlen(str));
+        const size_t definitionStart = m_pendingDefinitions.length();
+        m_pendingDefinitions += RECORD_STRING;
+        AppendValue(m_pendingDefinitions, pos->second);
+        AppendValue(m_pendingDefinitions, length);
+        m_pendingDefinitions.append(str, length);
+        m_stringDefinitions.append(m_pendingDefinitions, definitionStart, std::string::npos);
+        // (the records in the ring that refer to this need it to be recovered)
+        if (m_crashRingEnabled)
+            {
+            AppendToCrashRing(m_pendingDefinitions.data() + definitionStart,
+                              m_pendingDefinitions.length() - definitionStart);
+            }
+        if (m_emergencyFlushEnabled)
+            {
+            AppendToEmergencyBuffer(m_pendingDefinitions.data() + definitionStart,
+                                    m_pendingDefinitions.length() - definitionStart);
+            }
+        }
+    staging.m_internedIds.emplace(str, pos->second);
+    return pos->second;
+    }
+
+size_t wxLogFile::StagingBuffer::RemoveRecords(const wxLogLevel level, const size_t bytesToFree,
+                                               uint64_t& recordsRemoved)
+    {
+    size_t bytesFreed{ 0 };
+    std::string keptData;
+    std::vector<RecordStart> keptRecords;
+    keptData.reserve(m_data.length());
+    keptRecords.reserve(m_records.size());
+    for (size_t i = 0; i < m_records.size(); ++i)
+        {
+        const size_t recordLength = GetRecordLength(i);
+        if (bytesFreed < bytesToFree && m_records[i].m_level == level)
+            {
+            bytesFreed += recordLength;
+            ++recordsRemoved;
+            // (it was counted when it was committed, but won't be logged now;
+            // the count may have been reset since then, though)
+            uint64_t& levelCount = m_recordsPerLevel[GetStatisticsLevelIndex(level)];
+            if (levelCount > 0)
+                { --levelCount; }
+            continue;
+            }
+        RecordStart keptRecord = m_records[i];
+        keptRecord.m_offset = keptData.length();
+        keptRecords.push_back(keptRecord);
+        keptData.append(m_data, m_records[i].m_offset, recordLength);
+        }
+    m_data.swap(keptData);
+    m_records.swap(keptRecords);
+    return bytesFreed;
+    }
+
+bool wxLogFile::CommitRecord(StagingBuffer& staging)
+    {
+    const size_t recordLength = staging.GetRecordLength(staging.m_records.size() - 1);
+    const size_t hardLimit = m_hardLimit;
+    if (hardLimit > 0 && m_dropPolicy == DropPolicy::DropNewest &&
+        m_queuedBytes + recordLength > hardLimit)
+        {
+        staging.m_data.resize(staging.m_records.back().m_offset);
+        staging.m_records.pop_back();
+        ++m_droppedRecords;
+        ++m_unreportedDroppedRecords;
+        return false;
+        }
+    m_queuedBytes += recordLength;
+    if (m_crashRingEnabled)
+        { AppendToCrashRing(staging.m_data.data() + staging.m_records.back().m_offset, recordLength); }
+    if (m_emergencyFlushEnabled)
+        { AppendToEmergencyBuffer(staging.m_data.data() + staging.m_records.back().m_offset, recordLength); }
+    ++staging.m_recordsPerLevel[GetStatisticsLevelIndex(staging.m_records.back().m_level)];
+    return true;
+    }
+
+void wxLogFile::RecordFlushLatency(const std::chrono::steady_clock::duration latency)
+    {
+    const auto microseconds = std::chrono::duration_cast<std::chrono::microseconds>(latency);
+    size_t bucket{ 0 };
+    for (auto value = microseconds.count(); value > 1 && bucket + 1 < m_flushLatencyHistogram.size(); value >>= 1)
+        { ++bucket; }
+    std::lock_guard<std::mutex> lock(m_statisticsMutex);
+    ++m_flushLatencyHistogram[bucket];
+    m_flushLatencyMax = std::max(m_flushLatencyMax, microseconds);
+    }
+
+wxLogFile::Statistics wxLogFile::GetStatistics()
+    {
+    Statistics statistics;
+    std::vector<std::shared_ptr<StagingBuffer>> buffers;
+        {
+        std::lock_guard<std::mutex> lock(m_stagingBuffersMutex);
+        buffers = m_stagingBuffers;
+        // (read under this lock, as exited threads' counts are moved here when their buffers are removed)
+        statistics.m_recordsPerLevel = m_retiredRecordsPerLevel;
+        }
+    for (const auto& buffer : buffers)
+        {
+        std::lock_guard<std::mutex> lock(buffer->m_mutex);
+        for (size_t i = 0; i < statistics.m_recordsPerLevel.size(); ++i)
+            { statistics.m_recordsPerLevel[i] += buffer->m_recordsPerLevel[i]; }
+        }
+
+        {
+        std::lock_guard<std::mutex> lock(m_statisticsMutex);
+        statistics.m_bytesWritten = m_bytesWritten;
+        statistics.m_flushCount = m_flushCount;
+        statistics.m_flushLatencyMax = m_flushLatencyMax;
+        // a percentile is reported as the upper end of the bucket that it falls in
+        const auto getPercentile = [this](const double percentile)
+            {
+            uint64_t writeCount{ 0 };
+            for (const auto count : m_flushLatencyHistogram)
+                { writeCount += count; }
+            const auto rank = static_cast<uint64_t>(std::ceil(percentile * writeCount));
+            uint64_t seen{ 0 };
+            for (size_t i = 0; i < m_flushLatencyHistogram.size(); ++i)
+                {
+                seen += m_flushLatencyHistogram[i];
+                if (seen > 0 && seen >= rank)
+                    {
+                    return std::min(std::chrono::microseconds((int64_t{ 1 } << (i + 1)) - 1),
+                                    m_flushLatencyMax);
+                    }
+                }
+            return std::chrono::microseconds{ 0 };
+            };
+        statistics.m_flushLatencyP50 = getPercentile(0.5);
+        statistics.m_flushLatencyP99 = getPercentile(0.99);
+        }
+
+    statistics.m_queuedBytes = m_queuedBytes;
+    statistics.m_droppedRecords = m_droppedRecords;
+    statistics.m_rateLimitedRecords = m_rateLimitedRecords;
+    statistics.m_sampledOutRecords = m_sampledOutRecords;
+    return statistics;
+    }
+
+void wxLogFile::ResetStatistics()
+    {
+    std::vector<std::shared_ptr<StagingBuffer>> buffers;
+        {
+        std::lock_guard<std::mutex> lock(m_stagingBuffersMutex);
+        buffers = m_stagingBuffers;
+        m_retiredRecordsPerLevel.fill(0);
+        }
+    for (auto& buffer : buffers)
+        {
+        std::lock_guard<std::mutex> lock(buffer->m_mutex);
+        buffer->m_recordsPerLevel.fill(0);
+        }
+
+    std::lock_guard<std::mutex> lock(m_statisticsMutex);
+    m_bytesWritten = m_flushCount = 0;
+    m_flushLatencyHistogram.fill(0);
+    m_flushLatencyMax = std::chrono::microseconds{ 0 };
+    m_droppedRecords = 0;
+    m_rateLimitedRecords = 0;
+    m_sampledOutRecords = 0;
+    }
+
+void wxLogFile::ApplyBufferLimits()
+    {
+    const size_t hardLimit = m_hardLimit;
+    if (hardLimit > 0 && m_queuedBytes > hardLimit &&
+        m_dropPolicy == DropPolicy::DropLowestLevelFirst)
+        { DropLowestLevelRecords(); }
+    const size_t highWaterMark = m_highWaterMark;
+    if (highWaterMark > 0 && m_queuedBytes >= highWaterMark)
+        { FlushPending(); }
+    }
+
+void wxLogFile::DropLowestLevelRecords()
+    {
+    std::lock_guard<std::mutex> dropLock(m_dropMutex);
+    std::vector<std::shared_ptr<StagingBuffer>> buffers;
+        {
+        std::lock_guard<std::mutex> lock(m_stagingBuffersMutex);
+        buffers = m_stagingBuffers;
+        }
+
+    const size_t hardLimit = m_hardLimit;
+    while (m_queuedBytes > hardLimit)
+        {
+        // find the least severe level (i.e., the highest value) among the queued records
+        bool foundRecords{ false };
+        wxLogLevel lowestLevel{ wxLOG_FatalError };
+        for (const auto& buffer : buffers)
+            {
+            std::lock_guard<std::mutex> lock(buffer->m_mutex);
+            for (const auto& record : buffer->m_records)
+                {
+                lowestLevel = foundRecords ? std::max(lowestLevel, record.m_level) : record.m_level;
+                foundRecords = true;
+                }
+            }
+        if (!foundRecords)
+            { break; }
+
+        // drop the oldest records at that level until there is enough room
+        uint64_t recordsRemoved{ 0 };
+        for (auto& buffer : buffers)
+            {
+            const size_t queuedBytes = m_queuedBytes;
+            if (queuedBytes <= hardLimit)
+                { break; }
+            std::lock_guard<std::mutex> lock(buffer->m_mutex);
+            m_queuedBytes -= buffer->RemoveRecords(lowestLevel, queuedBytes - hardLimit, recordsRemoved);
+            }
+        m_droppedRecords += recordsRemoved;
+        m_unreportedDroppedRecords += recordsRemoved;
+        }
+    }
+
+void wxLogFile::SetRateLimit(const double recordsPerSecond, const size_t burstSize)
+    {
+    std::lock_guard<std::mutex> lock(m_rateLimitMutex);
+    m_rateLimitPerSecond = std::max(recordsPerSecond, 0.0);
+    m_rateLimitBurst = static_cast<double>(std::max<size_t>(burstSize, 1));
+    m_rateLimitBuckets.clear();
+    m_rateLimited = (m_rateLimitPerSecond > 0);
+    }
+
+uint64_t wxLogFile::HashRecord(const wxLogLevel level, const wxString& msg,
+                               const char* filePath, const char* func, const int line) noexcept
+    {
+    // FNV-1a; the file and function names are string literals, so their addresses are enough
+    constexpr uint64_t FNV_PRIME{ 0x100000001B3ULL };
+    uint64_t hash{ 0xCBF29CE484222325ULL };
+    const auto mix = [&hash](const uint64_t value) noexcept
+        {
+        hash ^= value;
+        hash *= FNV_PRIME;
+        };
+    mix(static_cast<uint64_t>(level));
+    mix(static_cast<uint64_t>(reinterpret_cast<uintptr_t>(filePath)));
+    mix(static_cast<uint64_t>(reinterpret_cast<uintptr_t>(func)));
+    mix(static_cast<uint64_t>(line));
+    for (const wxStringCharType* ch = msg.wx_str(); *ch != 0; ++ch)
+        { mix(static_cast<uint64_t>(*ch)); }
+    return hash;
+    }
+
+bool wxLogFile::IsDuplicateRecord(StagingBuffer& staging, const wxLogLevel level,
+                                  const uint64_t recordHash, const time_t timestamp)
+    {
+    if (recordHash != staging.m_lastRecordHash || level != staging.m_lastRecordLevel)
+        { return false; }
+    ++staging.m_repeatCount;
+    staging.m_lastRepeatTimestamp = timestamp;
+    return true;
+    }
+
+void wxLogFile::BeginUniqueRecord(StagingBuffer& staging, const wxLogLevel level,
+                                  const uint64_t recordHash)
+    {
+    AppendRepeatNotice(staging);
+    staging.m_lastRecordHash = recordHash;
+    staging.m_lastRecordLevel = level;
+    }
+
+void wxLogFile::AppendRepeatNotice(StagingBuffer& staging)
+    {
+    if (staging.m_repeatCount == 0)
+        { return; }
+    AppendNotice(staging, staging.m_lastRecordLevel, staging.m_lastRepeatTimestamp,
+        wxString::Format(_("The previous message was repeated %llu times."),
+                         static_cast<unsigned long long>(staging.m_repeatCount)));
+    staging.m_repeatCount = 0;
+    }
+
+bool wxLogFile::IsRateLimited(StagingBuffer& staging, const wxLogLevel level,
+                              const wxLogRecordInfo& info)
+    {
+    if (!m_rateLimited || info.filename == nullptr)
+        { return false; }
+
+    uint64_t discardedRecords{ 0 };
+        {
+        std::lock_guard<std::mutex> lock(m_rateLimitMutex);
+        if (m_rateLimitPerSecond <= 0)
+            { return false; }
+        const auto now = std::chrono::steady_clock::now();
+        const uint64_t callSite = HashRecord(wxLOG_Message, wxString{}, info.filename, nullptr, info.line);
+        auto [pos, inserted] =
+            m_rateLimitBuckets.try_emplace(callSite, RateLimitBucket{ m_rateLimitBurst, now, 0 });
+        RateLimitBucket& bucket = pos->second;
+        if (!inserted)
+            {
+            const std::chrono::duration<double> elapsed = now - bucket.m_lastRefill;
+            bucket.m_tokens = std::min(m_rateLimitBurst,
+                                       bucket.m_tokens + (elapsed.count() * m_rateLimitPerSecond));
+            bucket.m_lastRefill = now;
+            }
+        if (bucket.m_tokens < 1)
+            {
+            ++bucket.m_discardedRecords;
+            ++m_rateLimitedRecords;
+            return true;
+            }
+        bucket.m_tokens -= 1;
+        std::swap(discardedRecords, bucket.m_discardedRecords);
+        }
+
+    if (discardedRecords > 0)
+        {
+        AppendNotice(staging, level, info.timestamp,
+            wxString::Format(_("%llu messages from %s (line %d) were discarded by the rate limit."),
+                             static_cast<unsigned long long>(discardedRecords),
+                             wxString::FromUTF8(info.filename), info.line));
+        }
+    return false;
+    }
+
+void wxLogFile::SetSampling(const SamplingPolicy policy, const size_t sampleSize /*= 100*/,
+                            const long intervalMilliseconds /*= 1000*/)
+    {
+    m_sampleSize = std::max<size_t>(sampleSize, 1);
+    m_samplingInterval = std::chrono::milliseconds(std::max(intervalMilliseconds, 1L));
+    m_samplingPolicy = policy;
+
+    // log anything held under the old settings, and start every call site over
+    std::vector<std::shared_ptr<StagingBuffer>> buffers;
+        {
+        std::lock_guard<std::mutex> lock(m_stagingBuffersMutex);
+        buffers = m_stagingBuffers;
+        }
+    for (auto& buffer : buffers)
+        {
+        std::lock_guard<std::mutex> lock(buffer->m_mutex);
+        ReleaseSampledRecords(*buffer, true);
+        buffer->m_samplingStates.clear();
+        }
+    ApplyBufferLimits();
+    }
+
+bool wxLogFile::IsSampledOut(StagingBuffer& staging, const wxLogLevel level,
+                             const wxString& msg, const wxLogRecordInfo& info)
+    {
+    const SamplingPolicy policy = m_samplingPolicy;
+    if (policy == SamplingPolicy::KeepAll || (level != wxLOG_Debug && level != wxLOG_Trace) ||
+        info.filename == nullptr)
+        { return false; }
+    const uint64_t callSite = HashRecord(wxLOG_Message, wxString{}, info.filename, nullptr, info.line);
+    SamplingState& state = staging.m_samplingStates[callSite];
+    const size_t sampleSize = m_sampleSize;
+
+    if (policy == SamplingPolicy::OneInN)
+        {
+        if (state.m_seenRecords++ % sampleSize == 0)
+            { return false; }
+        ++m_sampledOutRecords;
+        return true;
+        }
+
+    // once the interval is over, log what was picked from it and start a new one
+    const auto now = std::chrono::steady_clock::now();
+    if (state.m_seenRecords == 0 || now - state.m_intervalStart >= m_samplingInterval.load())
+        {
+        ReleaseReservoir(staging, state);
+        state.m_seenRecords = 0;
+        state.m_intervalStart = now;
+        }
+    ++state.m_seenRecords;
+    if (state.m_reservoir.size() < sampleSize)
+        { state.m_reservoir.push_back({ level, msg, info, state.m_seenRecords }); }
+    else
+        {
+        // every record seen in the interval has the same chance of being in the reservoir
+        const uint64_t slot = std::uniform_int_distribution<uint64_t>(
+            0, state.m_seenRecords - 1)(staging.m_samplingRandom);
+        if (slot < sampleSize)
+            { state.m_reservoir[slot] = { level, msg, info, state.m_seenRecords }; }
+        // (either this record or the one that it replaced won't be logged)
+        ++m_sampledOutRecords;
+        }
+    return true;
+    }
+
+void wxLogFile::ReleaseSampledRecords(StagingBuffer& staging, const bool releaseAll)
+    {
+    const auto now = std::chrono::steady_clock::now();
+    const auto interval = m_samplingInterval.load();
+    for (auto pos = staging.m_samplingStates.begin(); pos != staging.m_samplingStates.end(); /* in loop */)
+        {
+        SamplingState& state = pos->second;
+        if (releaseAll || (!state.m_reservoir.empty() && now - state.m_intervalStart >= interval))
+            {
+            ReleaseReservoir(staging, state);
+            // (a call site that logs again starts a new interval)
+            pos = staging.m_samplingStates.erase(pos);
+            }
+        else
+            { ++pos; }
+        }
+    }
+
+void wxLogFile::ReleaseReservoir(StagingBuffer& staging, SamplingState& state)
+    {
+    if (state.m_reservoir.empty())
+        { return; }
+    std::sort(state.m_reservoir.begin(), state.m_reservoir.end(),
+        [](const auto& first, const auto& second) noexcept
+        { return first.m_sequence < second.m_sequence; });
+    AppendRepeatNotice(staging);
+    // the held records are older than the ones logged after them, so appending them
+    // to the buffer would put it out of order; instead, they go into a run of their
+    // own that Flush() merges with the buffer
+    staging.m_data.swap(staging.m_sampledData);
+    staging.m_records.swap(staging.m_sampledRecords);
+    staging.m_sampledRunStarts.push_back(staging.m_records.size());
+    for (const auto& record : state.m_reservoir)
+        { AppendRecord(staging, record.m_level, record.m_message, record.m_info); }
+    staging.m_data.swap(staging.m_sampledData);
+    staging.m_records.swap(staging.m_sampledRecords);
+    state.m_reservoir.clear();
+    // (the held records came between the last record and whatever is logged next,
+    //  so that isn't a repeat)
+    staging.m_lastRecordHash = 0;
+    }
+
+void wxLogFile::AppendNotice(StagingBuffer& staging, const wxLogLevel level,
+                             const time_t timestamp, const wxString& notice)
+    {
+    BeginRecord(staging, timestamp, level);
+    if (m_recordFormat == RecordFormat::Binary)
+        {
+        staging.m_data += RECORD_LEVEL_TEXT;
+        AppendValue(staging.m_data, static_cast<uint32_t>(level));
+        AppendSizedUTF8(staging.m_data, notice);
+        }
+    else
+        {
+        staging.m_data += GetLevelPrefix(level);
+        AppendMessageUTF8(staging.m_data, notice);
+        staging.m_data += '\n';
+        }
+    CommitRecord(staging);
+    }
+
+void wxLogFile::RecordSpanEvent(const char phase, const char* name,
+                                const std::chrono::steady_clock::time_point timestamp,
+                                const std::chrono::steady_clock::duration duration,
+                                const SpanArguments& arguments)
+    {
+    if (!m_tracing)
+        { return; }
+    StagingBuffer& staging = GetStagingBuffer();
+    std::lock_guard<std::mutex> lock(staging.m_mutex);
+    const size_t capacity = m_traceCapacity;
+    if (staging.m_traceEvents.size() != capacity)
+        {
+        staging.m_traceEvents.clear();
+        staging.m_traceEvents.resize(capacity);
+        staging.m_nextTraceEvent = staging.m_traceEventCount = 0;
+        }
+
+    // overwrite the oldest event once the ring is full, reusing its strings' memory
+    TraceEvent& event = staging.m_traceEvents[staging.m_nextTraceEvent];
+    staging.m_nextTraceEvent = (staging.m_nextTraceEvent + 1) % capacity;
+    staging.m_traceEventCount = std::min(staging.m_traceEventCount + 1, capacity);
+    event.m_phase = phase;
+    event.m_timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(timestamp - m_traceEpoch).count();
+    event.m_duration = std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+    event.m_name.assign((name != nullptr) ? name : "");
+    event.m_arguments.clear();
+    for (const auto& [argumentName, argumentValue] : arguments)
+        {
+        if (!event.m_arguments.empty())
+            { event.m_arguments += ','; }
+        const auto nameUTF8 = argumentName.utf8_str();
+        const auto valueUTF8 = argumentValue.utf8_str();
+        AppendJSONString(event.m_arguments, nameUTF8.data(), nameUTF8.length());
+        event.m_arguments += ':';
+        AppendJSONString(event.m_arguments, valueUTF8.data(), valueUTF8.length());
+        }
+    }
+
+std::string wxLogFile::FormatTrace()
+    {
+    std::vector<std::shared_ptr<StagingBuffer>> buffers;
+        {
+        std::lock_guard<std::mutex> lock(m_stagingBuffersMutex);
+        buffers = m_stagingBuffers;
+        }
+
+    const unsigned long processId = wxGetProcessId();
+    std::string trace{ "{\"traceEvents\":[" };
+    bool firstEvent{ true };
+    for (const auto& buffer : buffers)
+        {
+        std::lock_guard<std::mutex> lock(buffer->m_mutex);
+        const size_t capacity = buffer->m_traceEvents.size();
+        // oldest event first
+        size_t eventIndex = (buffer->m_nextTraceEvent + capacity - buffer->m_traceEventCount) % std::max<size_t>(capacity, 1);
+        for (size_t i = 0; i < buffer->m_traceEventCount; ++i, eventIndex = (eventIndex + 1) % capacity)
+            {
+            const TraceEvent& event = buffer->m_traceEvents[eventIndex];
+            trace += firstEvent ? "\n" : ",\n";
+            firstEvent = false;
+            trace += "{\"ph\":\"";
+            trace += event.m_phase;
+            trace += "\",\"cat\":\"wxLogFile\",\"pid\":";
+            AppendNumber(trace, processId);
+            trace += ",\"tid\":";
+            AppendNumber(trace, buffer->m_traceThreadId);
+            trace += ",\"ts\":";
+            AppendMicroseconds(trace, event.m_timestamp);
+            if (event.m_phase == 'X')
+                {
+                trace += ",\"dur\":";
+                AppendMicroseconds(trace, event.m_duration);
+                }
+            if (event.m_phase != 'E')
+                {
+                trace += ",\"name\":";
+                AppendJSONString(trace, event.m_name.data(), event.m_name.length());
+                }
+            if (!event.m_arguments.empty())
+                {
+                trace += ",\"args\":{";
+                trace += event.m_arguments;
+                trace += '}';
+                }
+            trace += '}';
+            }
+        }
+    trace += "\n],\"displayTimeUnit\":\"ms\"}\n";
+    return trace;
+    }
+
+bool wxLogFile::ExportTrace(const wxString& filePath)
+    {
+    const std::string trace = FormatTrace();
+    wxFile exportFile;
+    return exportFile.Create(filePath, true) &&
+        exportFile.Write(trace.data(), trace.length()) == trace.length();
+    }
+
+void wxLogFile::ClearTrace()
+    {
+    std::vector<std::shared_ptr<StagingBuffer>> buffers;
+        {
+        std::lock_guard<std::mutex> lock(m_stagingBuffersMutex);
+        buffers = m_stagingBuffers;
+        }
+    for (auto& buffer : buffers)
+        {
+        std::lock_guard<std::mutex> lock(buffer->m_mutex);
+        buffer->m_nextTraceEvent = buffer->m_traceEventCount = 0;
+        }
+    }
+
+bool wxLogFile::EnableCrashRing(const bool enable, const size_t ringSize)
+    {
+    if (!enable)
+        {
+        m_crashRingEnabled = false;
+        std::lock_guard<std::mutex> lock(m_crashRingMutex);
+        if (m_crashRing.GetWritableData() != nullptr)
+            {
+            m_crashRing.Unmap();
+            wxRemoveFile(m_crashRingPath);
+            }
+        // (unlocked after the ring is deleted, so another process never recovers it)
+        CloseDescriptor(m_crashRingLockDescriptor);
+        m_crashRingLockDescriptor = -1;
+        return true;
+        }
+
+    // anything logged before the ring was enabled isn't in it, so start from a flushed log
+    FlushAndWait();
+    std::lock_guard<std::mutex> lock(m_crashRingMutex);
+    // the ring is shared by every instance of the program, so only the one that
+    // holds the lock can use it
+    if (m_crashRingLockDescriptor == -1)
+        { m_crashRingLockDescriptor = LockFileExclusively(GetCrashRingLockPath()); }
+    const size_t capacity = std::max<size_t>(ringSize, 4096);
+    if (m_crashRingLockDescriptor == -1 ||
+        !m_crashRing.MapForWriting(m_crashRingPath, CRASH_RING_HEADER_SIZE + capacity))
+        {
+        m_crashRingEnabled = false;
+        return false;
+        }
+    CrashRingHeader header;
+    std::memcpy(header.m_magic, CRASH_RING_MAGIC, sizeof(CRASH_RING_MAGIC));
+    header.m_capacity = capacity;
+    header.m_recordFormat = static_cast<uint32_t>(m_recordFormat.load());
+    const wxString logFilePath{ m_logFilePath };
+    const auto logFilePathUTF8 = logFilePath.utf8_str();
+    header.m_logFilePathLength =
+        static_cast<uint32_t>(std::min(logFilePathUTF8.length(), sizeof(header.m_logFilePath)));
+    std::memcpy(header.m_logFilePath, logFilePathUTF8.data(), header.m_logFilePathLength);
+    std::memcpy(m_crashRing.GetWritableData(), &header, sizeof(header));
+    m_crashRingEnabled = true;
+    return true;
+    }
+
+void wxLogFile::AppendToCrashRing(const char* data, size_t length)
+    {
+    std::lock_guard<std::mutex> lock(m_crashRingMutex);
+    char* mappedData = m_crashRing.GetWritableData();
+    if (mappedData == nullptr)
+        { return; }
+    auto* header = reinterpret_cast<CrashRingHeader*>(mappedData);
+    char* ring = mappedData + CRASH_RING_HEADER_SIZE;
+    const uint64_t capacity = header->m_capacity;
+
+    // if this is bigger than the whole ring, only the end of it would survive anyway
+    const uint64_t newWritePosition = header->m_writePosition + length;
+    if (length > capacity)
+        {
+        data += length - capacity;
+        length = static_cast<size_t>(capacity);
+        }
+    const auto offset = static_cast<size_t>((newWritePosition - length) % capacity);
+    const size_t firstPart = std::min<size_t>(length, static_cast<size_t>(capacity) - offset);
+    std::memcpy(ring + offset, data, firstPart);
+    std::memcpy(ring, data + firstPart, length - firstPart);
+    // the record has to be in place before the header says that it's there
+    std::atomic_signal_fence(std::memory_order_release);
+    header->m_writePosition = newWritePosition;
+    }
+
+uint64_t wxLogFile::GetCrashRingPosition()
+    {
+    if (!m_crashRingEnabled)
+        { return 0; }
+    std::lock_guard<std::mutex> lock(m_crashRingMutex);
+    const char* mappedData = m_crashRing.GetWritableData();
+    return (mappedData != nullptr) ?
+        reinterpret_cast<const CrashRingHeader*>(mappedData)->m_writePosition : 0;
+    }
+
+void wxLogFile::MarkCrashRingFlushed(const uint64_t position)
+    {
+    if (!m_crashRingEnabled)
+        { return; }
+    std::lock_guard<std::mutex> lock(m_crashRingMutex);
+    char* mappedData = m_crashRing.GetWritableData();
+    if (mappedData != nullptr)
+        {
+        auto* header = reinterpret_cast<CrashRingHeader*>(mappedData);
+        header->m_flushedPosition = std::max(header->m_flushedPosition, position);
+        }
+    }
+
+bool wxLogFile::RecoverCrashRing()
+    {
+    if (!wxFileExists(m_crashRingPath))
+        { return false; }
+    // if another process (e.g., another instance of the program) holds the lock, then the
+    // ring belongs to a session that is still running, so leave it alone
+    const int lockDescriptor = LockFileExclusively(GetCrashRingLockPath());
+    if (lockDescriptor == -1)
+        { return false; }
+    std::string unflushedRecords;
+    bool isBinary{ false };
+    wxString crashedLogFilePath;
+        {
+        wxMappedFile ringFile(m_crashRingPath);
+        CrashRingHeader header;
+        if (ringFile.GetLength() < CRASH_RING_HEADER_SIZE)
+            {
+            CloseDescriptor(lockDescriptor);
+            return false;
+            }
+        std::memcpy(&header, ringFile.GetData(), sizeof(header));
+        if (std::memcmp(header.m_magic, CRASH_RING_MAGIC, sizeof(CRASH_RING_MAGIC)) != 0 ||
+            header.m_capacity != ringFile.GetLength() - CRASH_RING_HEADER_SIZE ||
+            header.m_flushedPosition > header.m_writePosition ||
+            header.m_logFilePathLength > sizeof(header.m_logFilePath))
+            {
+            CloseDescriptor(lockDescriptor);
+            return false;
+            }
+
+        // only what was written after the last flush is missing from the log file,
+        // and only as much of that as the ring could hold
+        const uint64_t start = std::max(header.m_flushedPosition,
+            (header.m_writePosition > header.m_capacity) ? header.m_writePosition - header.m_capacity : 0);
+        const char* ring = ringFile.GetData() + CRASH_RING_HEADER_SIZE;
+        for (uint64_t position = start; position < header.m_writePosition; )
+            {
+            const auto offset = static_cast<size_t>(position % header.m_capacity);
+            const size_t partLength = static_cast<size_t>(
+                std::min<uint64_t>(header.m_writePosition - position, header.m_capacity - offset));
+            unflushedRecords.append(ring + offset, partLength);
+            position += partLength;
+            }
+        isBinary = (header.m_recordFormat == static_cast<uint32_t>(RecordFormat::Binary));
+        // if the ring wrapped over records that weren't flushed, then the first one is cut off
+        if (start > header.m_flushedPosition)
+            {
+            // a text record can be picked up at the next line, but there's no way to find
+            // where the next binary record starts
+            const size_t nextLine = unflushedRecords.find('\n');
+            if (isBinary || nextLine == std::string::npos)
+                { unflushedRecords.clear(); }
+            else
+                { unflushedRecords.erase(0, nextLine + 1); }
+            }
+        crashedLogFilePath = wxString::FromUTF8(header.m_logFilePath, header.m_logFilePathLength);
+        }
+    wxRemoveFile(m_crashRingPath);
+    CloseDescriptor(lockDescriptor);
+    if (unflushedRecords.empty())
+        { return false; }
+
+    // write the crashed session's log, followed by the records that it didn't get to write
+    std::string recoveredLog;
+    ReadFileBytes(crashedLogFilePath, recoveredLog);
+    if (isBinary && !IsBinaryLog(recoveredLog.data(), recoveredLog.length()))
+        { recoveredLog.assign(BINARY_LOG_MAGIC, sizeof(BINARY_LOG_MAGIC)); }
+    recoveredLog += unflushedRecords;
+
+    wxFileName recoveredFileName(crashedLogFilePath.empty() ? m_logFilePath : crashedLogFilePath);
+    recoveredFileName.SetName(recoveredFileName.GetName() + L"-recovered");
+    wxFile recoveredFile;
+    if (!recoveredFile.Create(recoveredFileName.GetFullPath(), true) ||
+        recoveredFile.Write(recoveredLog.data(), recoveredLog.length()) != recoveredLog.length())
+        { return false; }
+    m_recoveredLogFilePath = recoveredFileName.GetFullPath();
+    return true;
+    }
+
+bool wxLogFile::EnableEmergencyFlush(const bool enable, const size_t bufferSize)
+    {
+    if (!enable)
+        {
+        if (!m_emergencyFlushEnabled)
+            { return true; }
+        m_emergencyFlushEnabled = false;
+        wxLogFile* installedLogger{ this };
+        if (m_emergencyLogger.compare_exchange_strong(installedLogger, nullptr))
+            { RestoreFatalSignalHandlers(); }
+        std::lock_guard<std::mutex> lock(m_emergencyMutex);
+        CloseDescriptor(m_emergencyFileDescriptor.exchange(-1));
+        for (auto& buffer : m_emergencyBuffers)
+            {
+            buffer.m_length = 0;
+            buffer.m_data.reset();
+            }
+        m_emergencyBufferSize = 0;
+        return true;
+        }
+
+    if (m_emergencyFlushEnabled)
+        { return true; }
+    // only one logger's buffers can be written by the signal handler
+    wxLogFile* installedLogger{ nullptr };
+    if (!m_emergencyLogger.compare_exchange_strong(installedLogger, this))
+        { return false; }
+
+    // anything logged before the buffers were set up isn't in them, so start from a flushed log
+    FlushAndWait();
+        {
+        std::lock_guard<std::mutex> lock(m_emergencyMutex);
+        m_emergencyBufferSize = std::max<size_t>(bufferSize, 4096);
+        for (auto& buffer : m_emergencyBuffers)
+            {
+            buffer.m_data = std::make_unique<char[]>(m_emergencyBufferSize);
+            buffer.m_length = 0;
+            buffer.m_start = m_emergencyPosition;
+            }
+        m_activeEmergencyBuffer = 0;
+        m_emergencyWrittenPosition = m_emergencyPosition;
+        }
+    m_emergencyFlushEnabled = true;
+
+    // the handler can't create the log file, so it has to exist already
+    wxString errorMessage;
+    bool opened{ false };
+        {
+        std::lock_guard<std::mutex> lock(m_fileMutex);
+        opened = OpenLogFile(errorMessage);
+        if (opened)
+            { UpdateEmergencyFileDescriptor(); }
+        }
+    if (!errorMessage.empty())
+        { ReportError(errorMessage); }
+    if (!opened || m_emergencyFileDescriptor == -1)
+        {
+        // (the handlers weren't installed, so there is nothing to restore)
+        m_emergencyLogger = nullptr;
+        EnableEmergencyFlush(false);
+        return false;
+        }
+    InstallFatalSignalHandlers(&wxLogFile::OnFatalSignal);
+    return true;
+    }
+
+void wxLogFile::AppendToEmergencyBuffer(const char* data, const size_t length)
+    {
+    std::lock_guard<std::mutex> lock(m_emergencyMutex);
+    if (length > m_emergencyBufferSize)
+        { return; }
+    EmergencyBuffer* buffer = &m_emergencyBuffers[m_activeEmergencyBuffer];
+    if (buffer->m_length + length > m_emergencyBufferSize)
+        {
+        // switch to the other buffer, if everything in it has been written to the log file
+        EmergencyBuffer& otherBuffer = m_emergencyBuffers[1 - m_activeEmergencyBuffer];
+        if (otherBuffer.m_start + otherBuffer.m_length > m_emergencyWrittenPosition)
+            { return; }
+        // (the length is cleared first, so that the signal handler never
+        //  sees the new start with the old content)
+        otherBuffer.m_length = 0;
+        otherBuffer.m_start = m_emergencyPosition;
+        m_activeEmergencyBuffer = 1 - m_activeEmergencyBuffer;
+        buffer = &otherBuffer;
+        }
+    const size_t bufferLength = buffer->m_length;
+    std::memcpy(buffer->m_data.get() + bufferLength, data, length);
+    // the record has to be in place before the length says that it's there
+    buffer->m_length.store(bufferLength + length, std::memory_order_release);
+    m_emergencyPosition += length;
+    }
+
+uint64_t wxLogFile::GetEmergencyPosition()
+    {
+    if (!m_emergencyFlushEnabled)
+        { return 0; }
+    std::lock_guard<std::mutex> lock(m_emergencyMutex);
+    return m_emergencyPosition;
+    }
+
+void wxLogFile::MarkEmergencyBufferWritten(const uint64_t position) noexcept
+    {
+    uint64_t writtenPosition = m_emergencyWrittenPosition;
+    while (writtenPosition < position &&
+           !m_emergencyWrittenPosition.compare_exchange_weak(writtenPosition, position))
+        {}
+    }
+
+void wxLogFile::UpdateEmergencyFileDescriptor()
+    {
+    if (!m_emergencyFlushEnabled)
+        { return; }
+    // (a duplicate, so that the descriptor stays valid even if the log file is closed)
+    const int fileDescriptor = m_logFile.IsOpened() ? DuplicateDescriptor(m_logFile.fd()) : -1;
+    CloseDescriptor(m_emergencyFileDescriptor.exchange(fileDescriptor));
+    }
+
+void wxLogFile::WriteEmergencyBuffers() noexcept
+    {
+    const int fileDescriptor = m_emergencyFileDescriptor;
+    if (fileDescriptor == -1)
+        { return; }
+    const uint64_t writtenPosition = m_emergencyWrittenPosition;
+    // the older buffer goes first
+    const size_t firstBuffer =
+        (m_emergencyBuffers[0].m_start <= m_emergencyBuffers[1].m_start) ? 0 : 1;
+    for (size_t i = 0; i < m_emergencyBuffers.size(); ++i)
+        {
+        const EmergencyBuffer& buffer = m_emergencyBuffers[(firstBuffer + i) % m_emergencyBuffers.size()];
+        const char* data = buffer.m_data.get();
+        // if another thread switched buffers while this was reading, then read it again
+        uint64_t start{ 0 };
+        size_t length{ 0 };
+        for (int attempt = 0; attempt < 4; ++attempt)
+            {
+            start = buffer.m_start;
+            length = buffer.m_length.load(std::memory_order_acquire);
+            if (start == buffer.m_start)
+                { break; }
+            }
+        if (data == nullptr || start + length <= writtenPosition)
+            { continue; }
+        const auto skipped = static_cast<size_t>((writtenPosition > start) ? writtenPosition - start : 0);
+        WriteToDescriptor(fileDescriptor, data + skipped, length - skipped);
+        }
+    }
+
+void wxLogFile::OnFatalSignal(int signalNumber)
+    {
+    // (cleared first, so that a crash in here doesn't write the records again)
+    wxLogFile* logger = m_emergencyLogger.exchange(nullptr);
+    if (logger != nullptr)
+        { logger->WriteEmergencyBuffers(); }
+    // pass the signal on to the handler that was installed before
+    // (usually the default one, which ends the program)
+    RestoreFatalSignalHandlers(signalNumber);
+    std::raise(signalNumber);
+    }
+
+wxLogFile::StagingBuffer& wxLogFile::GetStagingBuffer()
+    {
+    // each thread remembers the buffers it got from the loggers that it used
+    // (loggers are told apart by ID, since a new logger could reuse an old one's address)
+    thread_local ThreadStagingCache threadCache;
+    for (const auto& entry : threadCache.m_entries)
+        {
+        if (entry.m_loggerId == m_loggerId)
+            { return *entry.m_buffer; }
+        }
+
+    const auto threadId = std::this_thread::get_id();
+    std::lock_guard<std::mutex> lock(m_stagingBuffersMutex);
+    auto bufferPos = std::find_if(m_stagingBuffers.cbegin(), m_stagingBuffers.cend(),
+        [&threadId](const auto& buffer)
+            { return buffer->m_threadId == threadId && !buffer->m_threadExited; });
+    if (bufferPos == m_stagingBuffers.cend())
+        {
+        m_stagingBuffers.push_back(std::make_shared<StagingBuffer>());
+        bufferPos = std::prev(m_stagingBuffers.cend());
+        (*bufferPos)->m_traceThreadId = ++m_traceThreadCount;
+        }
+    // forget the buffers of loggers that have been destroyed
+    threadCache.m_entries.erase(
+        std::remove_if(threadCache.m_entries.begin(), threadCache.m_entries.end(),
+            [](const auto& entry) { return entry.m_sharedBuffer.expired(); }),
+        threadCache.m_entries.end());
+    threadCache.m_entries.push_back({ m_loggerId, bufferPos->get(), *bufferPos });
+    return **bufferPos;
+    }
+
+void wxLogFile::MergeStagingBuffers()
+    {
+    std::vector<std::shared_ptr<StagingBuffer>> buffers;
+        {
+        std::lock_guard<std::mutex> lock(m_stagingBuffersMutex);
+        buffers = m_stagingBuffers;
+        }
+
+    // take each thread's records, leaving it with an empty buffer to keep logging into
+    for (auto& buffer : buffers)
+        {
+        std::lock_guard<std::mutex> lock(buffer->m_mutex);
+        AppendRepeatNotice(*buffer);
+        // (an exited thread won't log again to end its intervals)
+        ReleaseSampledRecords(*buffer, buffer->m_threadExited);
+        buffer->m_data.swap(buffer->m_flushData);
+        buffer->m_records.swap(buffer->m_flushRecords);
+        buffer->m_sampledData.swap(buffer->m_flushSampledData);
+        buffer->m_sampledRecords.swap(buffer->m_flushSampledRecords);
+        buffer->m_sampledRunStarts.swap(buffer->m_flushSampledRunStarts);
+        m_queuedBytes -= buffer->m_flushData.length() + buffer->m_flushSampledData.length();
+        m_bufferHasError = m_bufferHasError || buffer->m_hasError;
+        buffer->m_hasError = false;
+        }
+
+    // definitions of function and file names go ahead of the records that use them
+    // (this has to happen after taking the records, as anything that they refer
+    //  to was already defined before they were logged)
+    if (m_recordFormat == RecordFormat::Binary)
+        {
+        std::lock_guard<std::mutex> definitionsLock(m_stringDefinitionsMutex);
+        m_buffer += m_pendingDefinitions;
+        m_pendingDefinitions.clear();
+        }
+
+    // the sinks and the search index need to know where each record is
+    const bool trackRecords = m_hasSinks || m_searchIndexEnabled;
+    // each thread's records are in order, as is each run of records released from
+    // its sampling reservoirs, so those runs are what get merged
+    struct MergeRun
+        {
+        const std::string* m_data{ nullptr };
+        const std::vector<StagingBuffer::RecordStart>* m_records{ nullptr };
+        size_t m_record{ 0 };
+        size_t m_endRecord{ 0 };
+        };
+    std::vector<MergeRun> runs;
+    for (const auto& buffer : buffers)
+        {
+        if (buffer->m_flushRecords.size())
+            { runs.push_back({ &buffer->m_flushData, &buffer->m_flushRecords, 0, buffer->m_flushRecords.size() }); }
+        const auto& runStarts = buffer->m_flushSampledRunStarts;
+        for (size_t i = 0; i < runStarts.size(); ++i)
+            {
+            const size_t runEnd = (i + 1 < runStarts.size()) ?
+                runStarts[i + 1] : buffer->m_flushSampledRecords.size();
+            // (a run is empty if its records were dropped by the buffer limits)
+            if (runStarts[i] < runEnd)
+                { runs.push_back({ &buffer->m_flushSampledData, &buffer->m_flushSampledRecords, runStarts[i], runEnd }); }
+            }
+        }
+    // (a record ends where the next one in its buffer starts, even if that is in the next run)
+    const auto getRecordEnd = [](const MergeRun& run, const size_t record) noexcept
+        {
+        return (record + 1 < run.m_records->size()) ?
+            (*run.m_records)[record + 1].m_offset : run.m_data->length();
+        };
+    const auto appendRecords = [this, trackRecords, &getRecordEnd](const MergeRun& run, const size_t endRecord)
+        {
+        const auto& records = *run.m_records;
+        if (trackRecords)
+            {
+            for (size_t i = run.m_record; i < endRecord; ++i)
+                {
+                m_bufferRecords.push_back({ m_buffer.length() + records[i].m_offset - records[run.m_record].m_offset,
+                                            getRecordEnd(run, i) - records[i].m_offset,
+                                            records[i].m_level, records[i].m_timestamp });
+                }
+            }
+        const size_t dataStart = records[run.m_record].m_offset;
+        m_buffer.append(*run.m_data, dataStart, getRecordEnd(run, endRecord - 1) - dataStart);
+        };
+
+    if (runs.size() == 1)
+        {
+        // only one thread logged anything, so its records are already in order
+        appendRecords(runs.front(), runs.front().m_endRecord);
+        }
+    else if (runs.size() > 1)
+        {
+        // merge the runs by timestamp, using the order that the records were logged in to break ties
+        const auto isLater = [](const MergeRun& first, const MergeRun& second) noexcept
+            {
+            const auto& firstRecord = (*first.m_records)[first.m_record];
+            const auto& secondRecord = (*second.m_records)[second.m_record];
+            return (firstRecord.m_timestamp != secondRecord.m_timestamp) ?
+                (firstRecord.m_timestamp > secondRecord.m_timestamp) :
+                (firstRecord.m_sequence > secondRecord.m_sequence);
+            };
+        std::priority_queue<MergeRun, std::vector<MergeRun>, decltype(isLater)> cursors(isLater,
+                                                                                         std::move(runs));
+        while (!cursors.empty())
+            {
+            MergeRun cursor = cursors.top();
+            cursors.pop();
+            appendRecords(cursor, cursor.m_record + 1);
+            if (++cursor.m_record < cursor.m_endRecord)
+                { cursors.push(cursor); }
+            }
+        }
+
+    for (auto& buffer : buffers)
+        {
+        buffer->m_flushData.clear();
+        buffer->m_flushRecords.clear();
+        buffer->m_flushSampledData.clear();
+        buffer->m_flushSampledRecords.clear();
+        buffer->m_flushSampledRunStarts.clear();
+        }
+
+    // note in the log if anything was lost
+    const uint64_t droppedRecords = m_unreportedDroppedRecords.exchange(0);
+    if (droppedRecords > 0)
+        {
+        const wxString notice = wxString::Format(
+            _("%llu log records were dropped because the log buffer was full."),
+            static_cast<unsigned long long>(droppedRecords));
+        const size_t noticeStart = m_buffer.length();
+        if (m_recordFormat == RecordFormat::Binary)
+            {
+            m_buffer += RECORD_LEVEL_TEXT;
+            AppendValue(m_buffer, static_cast<uint32_t>(wxLOG_Warning));
+            AppendSizedUTF8(m_buffer, notice);
+            }
+        else
+            {
+            m_buffer += GetLevelPrefix(wxLOG_Warning);
+            AppendMessageUTF8(m_buffer, notice);
+            m_buffer += '\n';
+            }
+        if (trackRecords)
+            {
+            m_bufferRecords.push_back({ noticeStart, m_buffer.length() - noticeStart,
+                                        wxLOG_Warning, std::time(nullptr) });
+            }
+        }
+
+    // let go of the buffers from threads that have ended, once they are empty
+    std::lock_guard<std::mutex> lock(m_stagingBuffersMutex);
+    m_stagingBuffers.erase(std::remove_if(m_stagingBuffers.begin(), m_stagingBuffers.end(),
+        [this](const auto& buffer)
+            {
+            if (!buffer->m_threadExited)
+                { return false; }
+            std::lock_guard<std::mutex> bufferLock(buffer->m_mutex);
+            // (spans are kept until they are cleared, even after their thread exits)
+            if (!buffer->m_data.empty() || !buffer->m_sampledData.empty() || buffer->m_traceEventCount > 0)
+                { return false; }
+            // keep the exited thread's counts for the statistics
+            for (size_t i = 0; i < m_retiredRecordsPerLevel.size(); ++i)
+                { m_retiredRecordsPerLevel[i] += buffer->m_recordsPerLevel[i]; }
+            return true;
+            }),
+        m_stagingBuffers.end());
+    }
+
+bool wxLogFile::IsBinaryLog(const char* data, const size_t length) noexcept
+    {
+    return (length >= sizeof(BINARY_LOG_MAGIC) &&
+            std::memcmp(data, BINARY_LOG_MAGIC, sizeof(BINARY_LOG_MAGIC)) == 0);
+    }
+
+size_t wxLogFile::GetBinaryLogHeaderLength() noexcept
+    { return sizeof(BINARY_LOG_MAGIC); }
+
+wxString wxLogFile::RenderBinaryLog(const char* data, const size_t length)
+    {
+    wxString logText;
+    const char* pos = data;
+    const char* const end = data + length;
+    if (IsBinaryLog(data, length))
+        { pos += sizeof(BINARY_LOG_MAGIC); }
+
+    BinaryLogStrings strings;
+    wxString recordText;
+    // stops at the end, or if the file is corrupt or truncated
+    while (pos < end && DecodeBinaryRecord(pos, end, strings, &recordText))
+        { logText += recordText; }
+    return logText;
+    }
+
+bool wxLogFile::DecodeBinaryRecord(const char*& pos, const char* end,
+                                   BinaryLogStrings& strings, wxString* text,
+                                   bool* isDefinition /*= nullptr*/)
+    {
+    if (pos >= end)
+        { return false; }
+    if (text != nullptr)
+        { text->clear(); }
+    const wxString notAvailable{ L"NA" };
+
+    const char recordType = *pos++;
+    if (isDefinition != nullptr)
+        { *isDefinition = (recordType == RECORD_STRING); }
+    const char* str{ nullptr };
+    uint32_t strLength{ 0 };
+    if (recordType == RECORD_STRING)
+        {
+        uint32_t id{ 0 };
+        if (!ReadValue(pos, end, id) || !ReadBytes(pos, end, str, strLength))
+            { return false; }
+        strings[id] = wxString(str, strLength);
+        }
+    else if (recordType == RECORD_FULL)
+        {
+        int64_t timestamp{ 0 };
+        uint32_t level{ 0 }, funcId{ 0 }, fileId{ 0 };
+        int32_t line{ 0 };
+        if (!ReadValue(pos, end, timestamp) || !ReadValue(pos, end, level) ||
+            !ReadValue(pos, end, funcId) || !ReadValue(pos, end, fileId) ||
+            !ReadValue(pos, end, line) || !ReadBytes(pos, end, str, strLength))
+            { return false; }
+        if (text != nullptr)
+            {
+            const auto funcPos = strings.find(funcId);
+            const auto filePathPos = strings.find(fileId);
+            *text = FormatRecord(level, wxString::FromUTF8(str, strLength),
+                                 static_cast<time_t>(timestamp),
+                                 (funcPos != strings.cend()) ? funcPos->second : notAvailable,
+                                 (filePathPos != strings.cend()) ?
+                                    wxFileName(filePathPos->second).GetFullName() : notAvailable,
+                                 line);
+            }
+        }
+    else if (recordType == RECORD_LEVEL_TEXT)
+        {
+        uint32_t level{ 0 };
+        if (!ReadValue(pos, end, level) || !ReadBytes(pos, end, str, strLength))
+            { return false; }
+        if (text != nullptr)
+            { *text << GetLevelPrefix(level) << FormatMessageLines(wxString::FromUTF8(str, strLength)) << L"\n"; }
+        }
+    else if (recordType == RECORD_TEXT)
+        {
+        if (!ReadBytes(pos, end, str, strLength))
+            { return false; }
+        if (text != nullptr)
+            { *text << FormatMessageLines(wxString::FromUTF8(str, strLength)) << L"\n"; }
+        }
+    else
+        { return false; }
+    return true;
+    }
+
+void wxLogFile::DoLogText(const wxString &msg)
+    {
+        {
+        StagingBuffer& staging = GetStagingBuffer();
+        std::lock_guard<std::mutex> lock(staging.m_mutex);
+        const time_t timestamp = std::time(nullptr);
+        if (m_suppressDuplicates)
+            {
+            const uint64_t recordHash = HashRecord(wxLOG_Message, msg, nullptr, nullptr, 0);
+            if (IsDuplicateRecord(staging, wxLOG_Message, recordHash, timestamp))
+                { return; }
+            BeginUniqueRecord(staging, wxLOG_Message, recordHash);
+            }
+        BeginRecord(staging, timestamp, wxLOG_Message);
+        if (m_recordFormat == RecordFormat::Binary)
+            {
+            staging.m_data += RECORD_TEXT;
+            AppendSizedUTF8(staging.m_data, msg);
+            }
+        else
+            {
+            AppendMessageUTF8(staging.m_data, msg);
+            staging.m_data += '\n';
+            }
+        if (!CommitRecord(staging))
+            { return; }
+        }
+    ApplyBufferLimits();
+    }
+
+void wxLogFile::DoLogTextAtLevel(wxLogLevel level, const wxString &msg)
+    {
+        {
+        StagingBuffer& staging = GetStagingBuffer();
+        std::lock_guard<std::mutex> lock(staging.m_mutex);
+        const time_t timestamp = std::time(nullptr);
+        if (m_suppressDuplicates)
+            {
+            const uint64_t recordHash = HashRecord(level, msg, nullptr, nullptr, 0);
+            if (IsDuplicateRecord(staging, level, recordHash, timestamp))
+                { return; }
+            BeginUniqueRecord(staging, level, recordHash);
+            }
+        BeginRecord(staging, timestamp, level);
+        if (m_recordFormat == RecordFormat::Binary)
+            {
+            staging.m_data += RECORD_LEVEL_TEXT;
+            AppendValue(staging.m_data, static_cast<uint32_t>(level));
+            AppendSizedUTF8(staging.m_data, msg);
+            }
+        else
+            {
+            staging.m_data += GetLevelPrefix(level);
+            AppendMessageUTF8(staging.m_data, msg);
+            staging.m_data += '\n';
+            }
+        if (!CommitRecord(staging))
+            { return; }
+        if (level == wxLOG_Error || level == wxLOG_FatalError)
+            { staging.m_hasError = true; }
+        }
+    ApplyBufferLimits();
+    }
+
+void wxLogFile::DoLogRecord(wxLogLevel level, const wxString &msg, const wxLogRecordInfo &info)
+    {
+        {
+        StagingBuffer& staging = GetStagingBuffer();
+        std::lock_guard<std::mutex> lock(staging.m_mutex);
+        // sample verbose records, collapse copies of the same record and throttle
+        // noisy call sites before spending any time formatting it
+        if (IsSampledOut(staging, level, msg, info))
+            { return; }
+        uint64_t recordHash{ 0 };
+        if (m_suppressDuplicates)
+            {
+            recordHash = HashRecord(level, msg, info.filename, info.func, info.line);
+            if (IsDuplicateRecord(staging, level, recordHash, info.timestamp))
+                { return; }
+            }
+        if (IsRateLimited(staging, level, info))
+            { return; }
+        if (m_suppressDuplicates)
+            { BeginUniqueRecord(staging, level, recordHash); }
+        if (!AppendRecord(staging, level, msg, info))
+            { return; }
+        }
+    ApplyBufferLimits();
+    }
+
+bool wxLogFile::AppendRecord(StagingBuffer& staging, const wxLogLevel level,
+                             const wxString& msg, const wxLogRecordInfo& info)
+    {
+    if (m_recordFormat == RecordFormat::Binary)
+        {
+        // just store the raw values; they will be formatted if the log is ever read
+        const uint32_t funcId = InternString(staging, info.func);
+        const uint32_t fileId = InternString(staging, info.filename);
+        BeginRecord(staging, info.timestamp, level);
+        staging.m_data += RECORD_FULL;
+        AppendValue(staging.m_data, static_cast<int64_t>(info.timestamp));
+        AppendValue(staging.m_data, static_cast<uint32_t>(level));
+        AppendValue(staging.m_data, funcId);
+        AppendValue(staging.m_data, fileId);
+        AppendValue(staging.m_data, static_cast<int32_t>(info.line));
+        AppendSizedUTF8(staging.m_data, msg);
+        }
+    else
+        {
+        BeginRecord(staging, info.timestamp, level);
+        AppendTextRecord(staging, level, msg, info);
+        }
+    if (!CommitRecord(staging))
+        { return false; }
+    if (level == wxLOG_Error || level == wxLOG_FatalError)
+        { staging.m_hasError = true; }
+    return true;
     }
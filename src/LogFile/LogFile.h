@@ -16,33 +16,1140 @@
 #include <wx/file.h>
 #include <wx/filename.h>
 #include <wx/stdpaths.h>
+#include <wx/wfstream.h>
+#include <wx/zstream.h>
+#include "MappedFile.h"
+#include "LogFileSink.h"
+#include "LogFileIndex.h"
+#include <algorithm>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <charconv>
+#include <iterator>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <array>
+#include <cmath>
+#include <queue>
+#include <ctime>
+#include <functional>
+#include <random>
+#include <utility>
 
-/** Logging system that writes its records to a temp file.*/
+/** @brief Logging system that writes its records to a temp file.
+
+    The file isn't created until the first flush, so constructing the logger during
+    startup doesn't touch the disk. If the file can't be created or written to,
+    the function passed to SetErrorHandler() is called (rather than showing a message box).
+
+    By default, records are written to the file on whichever thread calls Flush()
+    (usually the main thread during idle time). Call EnableAsyncWriting() to hand
+    the queued records off to a dedicated writer thread instead, so that the
+    calling thread never touches the disk.
+
+    The log file is kept open for the lifetime of the logger, and everything queued
+    up since the last flush is written in a single write. How often the data is forced
+    to the disk is controlled by SetSyncPolicy().
+
+    Records can also be stored in a compact binary format (see SetRecordFormat()),
+    which skips the text formatting while logging and only renders records as text
+    when the log is read or exported.
+
+    For long-running sessions, the log file can be rotated once it reaches a certain
+    size or age (see SetRotation()). Rotated files are gzip-compressed in the background.
+
+    Each thread logs into its own staging buffer, so threads logging at the same time
+    don't contend with each other. Flush() merges these buffers in timestamp order.
+    By default, wxWidgets routes messages from worker threads through the main thread;
+    to have a worker thread log directly into its own buffer, call
+    `wxLog::SetThreadActiveTarget()` with this logger from that thread.
+
+    To keep memory use predictable during bursts of logging, SetBufferLimits() can
+    flush automatically once the queued records reach a certain size, and drop
+    records once they reach a hard limit.
+
+    When a loop logs the same message over and over, SuppressDuplicates() collapses
+    the copies into a single "repeated N times" note, and SetRateLimit() caps how many
+    records each call site can log per second. SetSampling() keeps only a sample of the
+    debug and trace records, so verbose tracing can be left on without logging all of it.
+
+    GetStatistics() reports how much is being logged and how long writing it takes,
+    which helps with tuning the flushing and buffering options above.
+
+    The logger can also record timed spans (see wxLogFileSpan and EnableTracing()),
+    which are kept in memory and can be exported for Chrome's trace viewer
+    (or Perfetto) with ExportTrace().
+
+    Records that haven't been flushed yet are lost if the program crashes. To keep them,
+    EnableCrashRing() also copies each record into a memory-mapped ring file as it is logged.
+    The next time a logger is constructed, any records in the ring that never made it
+    into the log file are recovered (see GetRecoveredLogFilePath()).
+    EnableEmergencyFlush() covers the same records differently: if the program crashes with
+    a fatal signal, the records are appended to the log file itself before the program ends.
+
+    Besides the log file, records can be sent to other destinations (e.g., an in-memory
+    ring for a live log panel, or a compressed archive) with AddSink(). Each record is
+    only formatted once, and every sink shares the same batch of formatted records.
+
+    To find records in a large log without scanning it, EnableSearchIndex() keeps a word
+    index of the log file that is updated with each flush and can be queried with Search()
+    (or SearchAll(), which includes the rotated log files).*/
 class wxLogFile : public wxLog
     {
 public:
-    wxLogFile();
-    
+    /// @brief When written records are forced out of the OS cache and onto the disk.
+    enum class SyncPolicy
+        {
+        /// Never force a sync; leave it to the OS (the default).
+        Never,
+        /// Sync if a given number of milliseconds have passed since the last sync.
+        Interval,
+        /// Sync right after writing any error (or fatal error) records.
+        OnError
+        };
+
+    /// @brief Which records to drop when the queued records reach their hard limit.
+    enum class DropPolicy
+        {
+        /// Drop the incoming record.
+        DropNewest,
+        /// Drop queued records with the least severe level (e.g., trace and debug messages)
+        /// first, moving on to more severe levels only if that doesn't free enough room.
+        DropLowestLevelFirst
+        };
+
+    /// @brief How records are stored in the log file.
+    enum class RecordFormat
+        {
+        /// Tab-delimited text, formatted when the record is logged (the default).
+        Text,
+        /// Raw record data (timestamp, level, call site, and message), which is only
+        /// formatted into text when the log is read or exported.
+        Binary
+        };
+
+    /// Constructor, which logs to @c <AppName><date>.log in the temp folder (with the crash
+    ///     ring in @c <AppName>.logring, so that it is found by the next session on any day).
+    wxLogFile() : wxLogFile(GetDefaultLogFilePath(), GetDefaultCrashRingPath())
+        {}
+    /** @brief Constructor, which logs to a given file instead of the application's log.
+        @param logFilePath The log file (which is cleared and created on the first flush).
+        @note The crash ring is kept next to the log file, with the extension @c .logring.*/
+    explicit wxLogFile(const wxString& logFilePath);
+    /// Destructor. Writes any queued records and stops the writer thread (if running).
+    ~wxLogFile();
+
     /// @returns The string contents with all messages logged.
+    /// @note If writing asynchronously, this will wait for all queued records
+    ///     to be written to the file first.
     [[nodiscard]] wxString ReadLog();
+    /** @returns The logged messages as UTF-8 text.
+        @details Text records are stored as UTF-8, so (unlike ReadLog()) they are returned
+            as-is, without being converted. Binary records are rendered as text.
+        @note If writing asynchronously, this will wait for all queued records
+            to be written to the file first.*/
+    [[nodiscard]] std::string ReadLogUTF8();
+
+    /** @brief Writes the logged messages as text to a file.
+        @details If records are being stored in binary format, then they will
+            be rendered as text.
+        @param filePath The file to write to.
+        @returns @c true if the file was written.*/
+    bool ExportLog(const wxString& filePath);
+
+    /// @brief A function called when the log file can't be created or written to.
+    /// @details It is called with a message describing the problem.
+    using ErrorHandler = std::function<void (const wxString& message)>;
+    /** @brief Sets the function to call when the log file can't be created or written to.
+        @details The same problem is only reported once, until the file is written
+            to successfully again.
+        @param handler The function to call.
+        @note This may be called from the writer thread (see EnableAsyncWriting()),
+            so the handler should use @c CallAfter() to show anything in the UI.
+            It is called with none of the logger's locks held, so it can log the problem.
+        @par Example:
+        @code
+        logFile->SetErrorHandler([infoBar](const wxString& message)
+            {
+            infoBar->CallAfter([infoBar, message]()
+                { infoBar->ShowMessage(message, wxICON_WARNING); });
+            });
+        @endcode*/
+    void SetErrorHandler(ErrorHandler handler)
+        {
+        std::lock_guard<std::mutex> lock(m_errorMutex);
+        m_errorHandler = std::move(handler);
+        }
+    /// @returns The last problem creating or writing to the log file, or an empty string
+    ///     if there hasn't been one.
+    [[nodiscard]] wxString GetLastError()
+        {
+        std::lock_guard<std::mutex> lock(m_errorMutex);
+        return m_lastError;
+        }
+
+    /** @brief Adds a destination that each flushed batch of records is also sent to.
+        @param sink The sink to add.
+        @sa wxLogFileMemorySink, wxLogFileArchiveSink.*/
+    void AddSink(std::shared_ptr<wxLogFileSink> sink);
+    /// @brief Removes a sink (flushing it first).
+    /// @param sink The sink to remove.
+    void RemoveSink(const std::shared_ptr<wxLogFileSink>& sink);
 
     /// @returns The path of the log file.
     [[nodiscard]] const wxString& GetLogFilePath() const noexcept
         { return m_logFilePath; }
 
+    /** @brief Sets whether an index of the words in the log file's records is kept.
+        @details Each flushed batch of records is added to the index (and appended to the
+            index file) right after it is written, so searching never has to read the log file.\n
+            When the log file is rotated, its index is compacted (see wxLogFileIndex::Compact())
+            and kept with it (see GetRotatedSearchIndexPath()), so that SearchAll() can search
+            the rotated files without loading their indexes into memory.
+        @param enable @c true to keep the index.
+        @returns @c true if the index file was created (or @c enable was @c false).
+        @note Only records written after this is called are indexed, so it should be
+            called right after creating the logger.*/
+    bool EnableSearchIndex(const bool enable = true);
+    /// @returns @c true if the log file is being indexed.
+    [[nodiscard]] bool IsSearchIndexEnabled() const noexcept
+        { return m_searchIndexEnabled; }
+    /// @returns The path of the index file.
+    [[nodiscard]] wxString GetSearchIndexPath() const
+        { return m_logFilePath + L".idx"; }
+    /** @returns Where the records that match a query are in the log file, in file order.
+        @details Pass these to wxLogFileReader::GetRecordIndex() to read the records.
+        @param query What to search for.
+        @note Records that haven't been written to the log file yet aren't included,
+            so call FlushAndWait() first to search everything logged so far.*/
+    [[nodiscard]] std::vector<uint64_t> Search(const wxLogFileIndex::Query& query) const
+        { return m_searchIndex.Find(query); }
+    /** @returns The records that match a query in the log file and its rotated generations,
+            oldest generation first (and in file order within each one).
+        @details The rotated generations are gzip-compressed, so the offsets of their records
+            are in the decompressed files.
+        @param query What to search for.*/
+    [[nodiscard]] std::vector<wxLogFileIndex::Match> SearchAll(const wxLogFileIndex::Query& query) const;
+    /// @returns The path of a rotated log file's (compacted) index.
+    /// @param generation The generation of the log file (see GetRotatedLogFilePath()).
+    [[nodiscard]] wxString GetRotatedSearchIndexPath(const size_t generation) const
+        { return GetRotatedLogFilePath(generation) + L".idx"; }
+
+    /** @brief Sets whether records are written to the log file from a background thread.
+        @details When enabled, Flush() moves the queued records into a bounded queue
+            that a dedicated writer thread drains. If the queue is full, Flush()
+            will wait until the writer thread has made room.
+        @param enable Whether to write asynchronously.
+        @param maxQueuedBlocks The maximum number of flushed blocks that can be waiting
+            to be written before Flush() blocks.
+        @note Disabling asynchronous writing will write anything still in the queue
+            and stop the writer thread.*/
+    void EnableAsyncWriting(const bool enable, const size_t maxQueuedBlocks = 64);
+    /// @returns Whether records are being written from a background thread.
+    [[nodiscard]] bool IsAsyncWriting() const noexcept
+        { return m_asyncWriting; }
+
+    /** @brief Sets when written records should be synced to the disk.
+        @param policy The sync policy.
+        @param intervalMilliseconds When @c policy is SyncPolicy::Interval,
+            the number of milliseconds between syncs.*/
+    void SetSyncPolicy(const SyncPolicy policy, const long intervalMilliseconds = 1000)
+        {
+        std::lock_guard<std::mutex> lock(m_fileMutex);
+        m_syncPolicy = policy;
+        m_syncInterval = std::chrono::milliseconds(std::max(intervalMilliseconds, 0L));
+        }
+    /// @returns The policy for syncing written records to the disk.
+    [[nodiscard]] SyncPolicy GetSyncPolicy() const noexcept
+        { return m_syncPolicy; }
+
+    /** @brief Sets when the log file should be rotated.
+        @details When the log file grows past @c maxFileSize bytes, or has been written
+            to for longer than @c intervalSeconds, it is moved to the first generation
+            (see GetRotatedLogFilePath()) and a new log file is started.
+            Older generations are shifted up by one, and anything past
+            @c keptGenerations is deleted.\n
+            The rotated file is gzip-compressed on a background thread, so logging
+            is never held up by the compression (it becomes the first generation
+            once it is compressed).
+        @param maxFileSize The file size (in bytes) that triggers a rotation,
+            or @c 0 to not rotate by size.
+        @param intervalSeconds The number of seconds that a log file is written to before
+            being rotated, or @c 0 to not rotate by time.
+        @param keptGenerations The number of rotated log files to keep.
+        @note ReadLog() only returns the records from the current log file.*/
+    void SetRotation(const wxFileOffset maxFileSize, const long intervalSeconds = 0,
+                     const size_t keptGenerations = 5);
+    /// @returns The path of a rotated (and compressed) log file.
+    /// @param generation The generation of the log file, where @c 1 is the most recently rotated.
+    [[nodiscard]] wxString GetRotatedLogFilePath(const size_t generation) const
+        { return m_logFilePath + wxString::Format(L".%zu.gz", generation); }
+
+    /** @brief Sets limits on how much memory the queued (i.e., not yet flushed) records can use.
+        @param highWaterMark When the queued records reach this many bytes, they are flushed
+            right away (from the thread that logged the last record), rather than waiting for
+            the next idle-time flush. @c 0 disables this.
+        @param hardLimit The most bytes that queued records can use, beyond which records are
+            dropped according to @c policy. @c 0 means no limit.
+        @param policy Which records to drop when @c hardLimit is reached.
+        @note When records are dropped, a warning noting how many were dropped is
+            written to the log at the next flush.*/
+    void SetBufferLimits(const size_t highWaterMark, const size_t hardLimit = 0,
+                         const DropPolicy policy = DropPolicy::DropLowestLevelFirst) noexcept
+        {
+        m_highWaterMark = highWaterMark;
+        m_hardLimit = hardLimit;
+        m_dropPolicy = policy;
+        }
+    /// @returns The number of bytes used by records that haven't been flushed yet.
+    [[nodiscard]] size_t GetQueuedBytes() const noexcept
+        { return m_queuedBytes; }
+    /// @returns The number of records that have been dropped because of the hard
+    ///     limit set by SetBufferLimits().
+    [[nodiscard]] uint64_t GetDroppedRecordCount() const noexcept
+        { return m_droppedRecords; }
+
+    /** @brief Sets whether consecutive copies of the same record (i.e., the same level,
+            message and call site logged by the same thread) are collapsed.
+        @details Copies are counted rather than formatted and written, and a note saying
+            how many times the previous message was repeated is logged once a different
+            record is logged (or at the next flush).
+        @param suppress @c true to collapse duplicate records.*/
+    void SuppressDuplicates(const bool suppress = true) noexcept
+        { m_suppressDuplicates = suppress; }
+    /// @returns @c true if consecutive duplicate records are collapsed.
+    [[nodiscard]] bool IsSuppressingDuplicates() const noexcept
+        { return m_suppressDuplicates; }
+    /** @brief Limits how many records each call site (i.e., source file and line) can log.
+        @details Each call site has a token bucket that holds up to @c burstSize records and
+            refills at @c recordsPerSecond. Records logged from a call site with an empty
+            bucket are discarded, and the next record that it is allowed to log is preceded
+            by a note saying how many were discarded.
+        @param recordsPerSecond How many records per second each call site can log
+            (once its burst is used up). @c 0 removes the limit.
+        @param burstSize How many records a call site can log at once.
+        @note Only records that come with their call site (i.e., that were logged
+            through the @c wxLog* functions) are limited.*/
+    void SetRateLimit(const double recordsPerSecond, const size_t burstSize = 10);
+    /// @returns The number of records that have been discarded because of SetRateLimit().
+    [[nodiscard]] uint64_t GetRateLimitedRecordCount() const noexcept
+        { return m_rateLimitedRecords; }
+
+    /// @brief How debug and trace records are sampled (see SetSampling()).
+    enum class SamplingPolicy
+        {
+        /// Keep every record (the default).
+        KeepAll,
+        /// Keep the first of every N records from each call site.
+        OneInN,
+        /// Keep N records, picked at random, from each call site per interval.
+        /// The picked records are held until the interval ends, and are then
+        /// logged with their original timestamps.
+        Reservoir
+        };
+    /** @brief Sets how many of the debug and trace records are kept.
+        @details Records are sampled before they are formatted, so the ones that
+            aren't kept cost next to nothing. Errors, warnings and other messages are
+            always kept.
+
+            Each thread samples the records that it logs by itself, so a call site
+            used by several threads is sampled separately for each of them.
+        @param policy How to pick the records to keep.
+        @param sampleSize For SamplingPolicy::OneInN, how many records to keep one of.
+            For SamplingPolicy::Reservoir, how many records to keep per interval.
+        @param intervalMilliseconds For SamplingPolicy::Reservoir, the length of each interval.
+        @note Only records that come with their call site (i.e., that were logged
+            through the @c wxLog* functions) are sampled.*/
+    void SetSampling(const SamplingPolicy policy, const size_t sampleSize = 100,
+                     const long intervalMilliseconds = 1000);
+    /// @returns How debug and trace records are sampled.
+    [[nodiscard]] SamplingPolicy GetSamplingPolicy() const noexcept
+        { return m_samplingPolicy; }
+    /// @returns The number of debug and trace records that weren't kept by SetSampling().
+    [[nodiscard]] uint64_t GetSampledOutRecordCount() const noexcept
+        { return m_sampledOutRecords; }
+
+    /// @brief Running statistics about the logger, returned by GetStatistics().
+    struct Statistics
+        {
+        /// @returns The number of records logged at a level.
+        /// @param level The level. Levels after @c wxLOG_Trace
+        ///     (e.g., user-defined levels) are counted together.
+        [[nodiscard]] uint64_t GetRecordCount(const wxLogLevel level) const noexcept
+            { return m_recordsPerLevel[GetStatisticsLevelIndex(level)]; }
+        /// @returns The number of records logged at all levels.
+        [[nodiscard]] uint64_t GetTotalRecordCount() const noexcept
+            {
+            uint64_t total{ 0 };
+            for (const auto count : m_recordsPerLevel)
+                { total += count; }
+            return total;
+            }
+
+        /// Records logged at each level (not including duplicates, or records that were dropped).
+        std::array<uint64_t, wxLOG_Trace + 2> m_recordsPerLevel{};
+        /// Bytes written to the log file.
+        uint64_t m_bytesWritten{ 0 };
+        /// The number of writes to the log file (i.e., flushes that had something to write).
+        uint64_t m_flushCount{ 0 };
+        /// @{
+        /// How long writing to (and syncing) the log file took. The percentiles are
+        ///     approximate (to within a factor of two), the maximum is exact.
+        std::chrono::microseconds m_flushLatencyP50{ 0 };
+        std::chrono::microseconds m_flushLatencyP99{ 0 };
+        std::chrono::microseconds m_flushLatencyMax{ 0 };
+        /// @}
+        /// Bytes used by records that haven't been flushed yet.
+        size_t m_queuedBytes{ 0 };
+        /// Records dropped because of the limits set by SetBufferLimits().
+        uint64_t m_droppedRecords{ 0 };
+        /// Records discarded because of SetRateLimit().
+        uint64_t m_rateLimitedRecords{ 0 };
+        /// Records not kept by SetSampling().
+        uint64_t m_sampledOutRecords{ 0 };
+        };
+    /// @returns Running statistics about how much has been logged and written,
+    ///     and how long writing it has taken.
+    [[nodiscard]] Statistics GetStatistics();
+    /// @brief Starts the statistics over.
+    /// @note The queued bytes aren't affected, as they are a current value rather than a total.
+    void ResetStatistics();
+
+    /// @brief Named values attached to a span, shown with it in the trace viewer.
+    using SpanArguments = std::vector<std::pair<wxString, wxString>>;
+    /** @brief Sets whether spans are recorded.
+        @details Each thread records its spans into its own ring buffer, so once a thread
+            has recorded @c eventsPerThread events, its oldest ones are overwritten.
+            Changing the size of the ring buffers clears them.
+        @param enable @c true to record spans.
+        @param eventsPerThread The number of span events kept for each thread.*/
+    void EnableTracing(const bool enable = true, const size_t eventsPerThread = 65536) noexcept
+        {
+        m_traceCapacity = std::max<size_t>(eventsPerThread, 1);
+        m_tracing = enable;
+        }
+    /// @returns @c true if spans are being recorded.
+    [[nodiscard]] bool IsTracing() const noexcept
+        { return m_tracing; }
+    /** @brief Starts a span on the calling thread, which ends at the next call to EndSpan()
+            (from the same thread).
+        @details Prefer wxLogFileSpan, which can't be left unended.
+        @param name The name of the span (in UTF-8).
+        @param arguments Values to show with the span.*/
+    void BeginSpan(const char* name, const SpanArguments& arguments = SpanArguments{})
+        { RecordSpanEvent('B', name, std::chrono::steady_clock::now(), {}, arguments); }
+    /// @brief Ends the span most recently started by BeginSpan() on the calling thread.
+    void EndSpan()
+        { RecordSpanEvent('E', nullptr, std::chrono::steady_clock::now(), {}, SpanArguments{}); }
+    /** @brief Records a span that has already finished.
+        @param name The name of the span (in UTF-8).
+        @param start When the span started.
+        @param end When the span ended.
+        @param arguments Values to show with the span.*/
+    void AddSpan(const char* name, const std::chrono::steady_clock::time_point start,
+                 const std::chrono::steady_clock::time_point end,
+                 const SpanArguments& arguments = SpanArguments{})
+        { RecordSpanEvent('X', name, start, end - start, arguments); }
+    /// @returns The recorded spans, formatted as Chrome @c trace_event JSON (in UTF-8).
+    [[nodiscard]] std::string FormatTrace();
+    /** @brief Writes the recorded spans to a file that can be loaded into
+            Chrome's trace viewer (@c chrome://tracing) or Perfetto.
+        @param filePath The file to write to.
+        @returns @c true if the file was written.*/
+    bool ExportTrace(const wxString& filePath);
+    /// @brief Discards the recorded spans.
+    void ClearTrace();
+
+    /** @brief Sets whether records are also copied into a memory-mapped ring file as they are logged.
+        @details The OS keeps what was written to the ring even if the program crashes, so
+            the records that hadn't been flushed to the log file yet can be recovered the next time
+            a logger is constructed (before it starts the log file over). The recovered records are
+            written, after the rest of the crashed session's log, to the file returned by
+            GetRecoveredLogFilePath().
+        @param enable @c true to copy records into the ring.
+        @param ringSize The size of the ring, which should be larger than what is logged
+            between flushes. Once the ring wraps around, the oldest records in it are overwritten.
+        @returns @c true if the ring file was mapped (or @c enable was @c false).
+            This fails if another logger (in this or another process) is using the ring.
+        @note The ring file is named after the application, so only one logger at a time
+            can use it. While it is in use, the ring is locked, so another instance of the
+            application won't recover (and delete) it when its logger is constructed.*/
+    bool EnableCrashRing(const bool enable = true, const size_t ringSize = 4 * 1024 * 1024);
+    /// @returns @c true if records are being copied into the crash ring.
+    [[nodiscard]] bool IsCrashRingEnabled() const noexcept
+        { return m_crashRingEnabled; }
+    /// @returns The path of the crash ring file.
+    [[nodiscard]] const wxString& GetCrashRingPath() const noexcept
+        { return m_crashRingPath; }
+    /// @returns The path of the file that is locked while a process uses the crash ring.
+    [[nodiscard]] wxString GetCrashRingLockPath() const
+        { return m_crashRingPath + L".lock"; }
+    /// @returns The path of the file that records from a crashed session were recovered into
+    ///     when this logger was constructed, or an empty string if nothing needed to be recovered.
+    [[nodiscard]] const wxString& GetRecoveredLogFilePath() const noexcept
+        { return m_recoveredLogFilePath; }
+
+    /** @brief Sets whether records that haven't been written yet are appended to the log file
+            when the program crashes (i.e., gets @c SIGSEGV, @c SIGABRT, @c SIGBUS, @c SIGFPE or @c SIGILL).
+        @details Each record is also copied into one of two fixed buffers as it is logged.
+            When one buffer fills up, records go into the other, once everything in it has
+            been written to the log file. The signal handler then only has to write the
+            unwritten part of the buffers to a file descriptor that was opened ahead of time,
+            so it doesn't allocate memory or lock anything.
+
+            After writing the records, the signal is passed on to the handler that was
+            installed before (usually the default one, which ends the program).
+        @param enable @c true to install the signal handler.
+        @param bufferSize The size of each of the two buffers, which should be larger than
+            what is logged between flushes. Records that don't fit aren't written by the handler.
+        @returns @c true if the handler was installed (or @c enable was @c false).
+            This fails if the log file can't be created, or if another logger is already using it.
+        @note Enabling this creates the log file right away.*/
+    bool EnableEmergencyFlush(const bool enable = true, const size_t bufferSize = 1024 * 1024);
+    /// @returns @c true if unwritten records are appended to the log file on a crash.
+    [[nodiscard]] bool IsEmergencyFlushEnabled() const noexcept
+        { return m_emergencyFlushEnabled; }
+
+    /** @brief Sets how records are stored in the log file.
+        @param format The record format.
+        @warning Changing the format starts a new log file (records logged in the old
+            format are discarded), so this should be called right after creating the logger.
+            The old file is deleted rather than cleared, so a wxLogFileReader that has it open
+            can still read it.*/
+    void SetRecordFormat(const RecordFormat format);
+    /// @returns How records are stored in the log file.
+    [[nodiscard]] RecordFormat GetRecordFormat() const noexcept
+        { return m_recordFormat; }
+
+    /** @brief Formats binary log data into text.
+        @param data The content of a binary log file.
+        @param length The length of @c data.
+        @returns The records as text, in the same layout as a text log file.*/
+    [[nodiscard]] static wxString RenderBinaryLog(const char* data, const size_t length);
+    /// @returns @c true if the data is from a log file that was written in binary format.
+    /// @param data The start of the log file's content.
+    /// @param length The length of @c data.
+    [[nodiscard]] static bool IsBinaryLog(const char* data, const size_t length) noexcept;
+    /// Function and file names defined in a binary log, by ID.
+    using BinaryLogStrings = std::unordered_map<uint32_t, wxString>;
+    /** @brief Reads the next record from binary log data.
+        @param[in,out] pos The position of the record, which will be moved past it.
+            (The file header should already be skipped.)
+        @param end The end of the data.
+        @param[in,out] strings The function and file names defined so far.
+            If the record is a definition, then it will be added to this.
+        @param[out] text If not null, receives the record formatted as text.
+            This will be empty if the record is a function or file name definition.
+        @param[out] isDefinition If not null, receives whether the record was a
+            function or file name definition (rather than a logged message).
+        @returns @c true if a record was read, or @c false if the data is
+            corrupt or truncated.*/
+    static bool DecodeBinaryRecord(const char*& pos, const char* end,
+                                   BinaryLogStrings& strings, wxString* text,
+                                   bool* isDefinition = nullptr);
+    /// @returns The length of the header at the start of binary log files.
+    [[nodiscard]] static size_t GetBinaryLogHeaderLength() noexcept;
+
+    /// Flushes the queued records, and (if writing asynchronously) waits
+    /// until the writer thread has written them to the log file.
+    /// @note Call this before reading the log file directly.
+    void FlushAndWait()
+        {
+        wxLogFile::Flush();
+        WaitUntilWritten();
+        }
+
     void Flush() final;
 
 protected:
-    void DoLogText(const wxString &msg) final
-        { m_buffer << msg << L"\n"; }
+    void DoLogText(const wxString &msg) final;
     void DoLogRecord(wxLogLevel level, const wxString &msg, const wxLogRecordInfo &info) final;
     void DoLogTextAtLevel(wxLogLevel level, const wxString &msg) final;
 private:
-    wxString m_buffer;
+    /// A batch of formatted records waiting to be written.
+    struct PendingBlock
+        {
+        std::string m_data;
+        // whether any of the records are errors (used by SyncPolicy::OnError)
+        bool m_hasError{ false };
+        // how much of the crash ring the block covers
+        uint64_t m_crashRingPosition{ 0 };
+        // how much of the emergency buffers the block covers
+        uint64_t m_emergencyPosition{ 0 };
+        // where the records are in the block (if they are being tracked)
+        std::vector<wxLogFileBatch::Record> m_records;
+        };
+
+    /// @returns The raw content of the log file (or what is queued up, if the file can't be read).
+    [[nodiscard]] std::string ReadLogBytes();
+    /// Appends a block of records to the log file and syncs it if the policy calls for it.
+    /// @param data The encoded records.
+    /// @param hasError Whether any of the records are errors.
+    /// @param records Where the records are in @c data (for the search index).
+    /// @param[out] errorMessage What went wrong (if it hasn't already been reported),
+    ///     for the caller to pass to ReportError() once the flush mutex is unlocked.
+    /// @returns @c true if the block was written.
+    bool WriteBlock(const std::string& data, const bool hasError,
+                    const std::vector<wxLogFileBatch::Record>& records,
+                    wxString& errorMessage);
+    /// Does the work for WriteBlock(), describing what went wrong in @c errorMessage
+    /// (if it hasn't already been reported) and where the block starts in @c fileOffset.
+    bool WriteBlockToFile(const std::string& data, const bool hasError,
+                          uint64_t& fileOffset, wxString& errorMessage);
+    /// Creates the log file (if it hasn't been yet), or reopens it if it was closed.
+    /// @note The file mutex must be locked by the caller.
+    bool OpenLogFile(wxString& errorMessage);
+    /// Passes a problem with the log file to the error handler.
+    /// @note The flush mutex must not be locked, as the handler may log something
+    ///     (which flushes if the high-water mark is reached).
+    void ReportError(const wxString& errorMessage);
+    /// Syncs the log file if there is unsynced data and the sync interval has elapsed.
+    void SyncIfDue();
+    /// @returns Whether writing the given number of bytes should go into a new log file.
+    [[nodiscard]] bool IsRotationDue(const size_t incomingBytes) const;
+    /// Moves the log file to the first rotated generation and starts a new log file.
+    /// @note The file mutex must be locked by the caller.
+    void RotateLogFile();
+    /// Starts the log file over, writing a binary header if needed.
+    /// @note The file mutex must be locked by the caller.
+    bool CreateLogFile();
+    /// A rotated log file waiting to be compressed.
+    struct RotatedFile
+        {
+        wxString m_path;
+        // the number of generations to keep when it is moved into the first one
+        size_t m_keptGenerations{ 0 };
+        };
+    /// Gzip-compresses a file and deletes the original.
+    static bool CompressFile(const wxString& sourcePath, const wxString& destinationPath);
+    /// Hands a rotated log file to the compression thread (starting it if needed).
+    /// @note The file mutex must be locked by the caller.
+    void QueueCompression(const wxString& uncompressedPath);
+    /// The compression thread's main loop, which compresses the rotated files in the
+    /// order that they were rotated.
+    void CompressionThreadMain();
+    /// Compresses a rotated log file (and compacts its index) and moves it into
+    /// the first generation, shifting the older generations up by one.
+    void CompressRotatedFile(const RotatedFile& rotatedFile);
+    /// Blocks until all queued blocks have been written by the writer thread.
+    void WaitUntilWritten();
+    /** @brief Writes whatever is queued and joins the writer thread.
+        @details A block that the writer thread couldn't write is written here instead
+            (or kept in the merged buffer for the next flush, if it still can't be).
+        @param[out] errorMessage What went wrong writing that block, for the caller to
+            report once it has unlocked the flush mutex.
+        @note The flush mutex must be locked by the caller.*/
+    void StopWriterThread(wxString& errorMessage);
+    /// Removes all of the queued blocks, combined into one.
+    /// @note The queue mutex must be locked by the caller, and the queue must not be empty.
+    PendingBlock TakeQueuedBlocks();
+    /// The writer thread's main loop.
+    void WriterThreadMain();
+
+    /// A span event in a thread's ring buffer.
+    struct TraceEvent
+        {
+        // 'B' (begin), 'E' (end) or 'X' (complete)
+        char m_phase{ 'X' };
+        // nanoseconds since the trace epoch
+        int64_t m_timestamp{ 0 };
+        int64_t m_duration{ 0 };
+        std::string m_name;
+        // the members of the event's "args" object, already formatted as JSON
+        std::string m_arguments;
+        };
+
+    /// A record held by SamplingPolicy::Reservoir until its interval ends.
+    struct SampledRecord
+        {
+        wxLogLevel m_level{ wxLOG_Debug };
+        wxString m_message;
+        wxLogRecordInfo m_info;
+        // where the record was in the order that the call site logged them
+        uint64_t m_sequence{ 0 };
+        };
+    /// A call site's sampling on one thread.
+    struct SamplingState
+        {
+        // records logged by the call site (in the current interval, for the reservoir)
+        uint64_t m_seenRecords{ 0 };
+        std::chrono::steady_clock::time_point m_intervalStart;
+        std::vector<SampledRecord> m_reservoir;
+        };
+
+    /** @brief Records logged by one thread that haven't been merged by Flush() yet.
+        @details The mutex is only contended while Flush() is taking the thread's records.*/
+    struct StagingBuffer
+        {
+        /// Where a record starts in the buffer, and the values used to order it
+        /// among the other threads' records.
+        struct RecordStart
+            {
+            size_t m_offset{ 0 };
+            time_t m_timestamp{ 0 };
+            uint64_t m_sequence{ 0 };
+            wxLogLevel m_level{ wxLOG_Message };
+            };
+
+        /// @returns The length of a record in the buffer.
+        /// @param index The record's index.
+        [[nodiscard]] size_t GetRecordLength(const size_t index) const noexcept
+            {
+            return ((index + 1 < m_records.size()) ?
+                    m_records[index + 1].m_offset : m_data.length()) - m_records[index].m_offset;
+            }
+        /** @brief Removes the oldest records at the given level (and takes them
+                back out of the buffer's count of records logged at that level).
+            @param level The level of records to remove.
+            @param bytesToFree How many bytes to free. Records stop being removed
+                once this is reached.
+            @param[out] recordsRemoved Incremented by the number of records that were removed.
+            @returns The number of bytes freed.*/
+        size_t RemoveRecords(const wxLogLevel level, const size_t bytesToFree, uint64_t& recordsRemoved);
+
+        /// @returns The timestamp formatted as text (in UTF-8), which is cached
+        ///     until the next second.
+        const std::string& GetTimestampText(const time_t timestamp);
+        /// @returns A file path's name (without its folder), in UTF-8.
+        const std::string& GetCachedFileName(const char* filePath);
+        /// @returns A function name in UTF-8.
+        const std::string& GetCachedFunctionName(const char* func);
+
+        std::mutex m_mutex;
+        std::string m_data;
+        std::vector<RecordStart> m_records;
+        bool m_hasError{ false };
+        // what Flush() took from this buffer, kept so that their memory is reused
+        std::string m_flushData;
+        std::vector<RecordStart> m_flushRecords;
+        // records released from sampling reservoirs, which were logged before the records
+        // around them, so each reservoir is staged as a run of its own (in the order that
+        // its records were logged) for Flush() to merge with the rest
+        std::string m_sampledData;
+        std::vector<RecordStart> m_sampledRecords;
+        // where each run starts in m_sampledRecords
+        std::vector<size_t> m_sampledRunStarts;
+        // what Flush() took from the runs
+        std::string m_flushSampledData;
+        std::vector<RecordStart> m_flushSampledRecords;
+        std::vector<size_t> m_flushSampledRunStarts;
+
+        std::thread::id m_threadId{ std::this_thread::get_id() };
+        std::atomic<bool> m_threadExited{ false };
+
+        // cached pieces of text records
+        time_t m_cachedTimestamp{ 0 };
+        std::string m_cachedTimestampText;
+        // function and file names are string literals, so these are keyed on their addresses
+        std::unordered_map<const char*, std::string> m_fileNameCache;
+        std::unordered_map<const char*, std::string> m_functionNameCache;
+        // IDs of interned function and file names (for binary records),
+        // valid while the logger's intern generation matches
+        std::unordered_map<const char*, uint32_t> m_internedIds;
+        uint64_t m_internGeneration{ 0 };
+
+        // the last record logged into this buffer, and how many copies of it were suppressed
+        uint64_t m_lastRecordHash{ 0 };
+        wxLogLevel m_lastRecordLevel{ wxLOG_Message };
+        time_t m_lastRepeatTimestamp{ 0 };
+        uint64_t m_repeatCount{ 0 };
+
+        // records committed to this buffer, by level
+        std::array<uint64_t, wxLOG_Trace + 2> m_recordsPerLevel{};
+
+        // sampling of this thread's debug and trace records, by call site
+        std::unordered_map<uint64_t, SamplingState> m_samplingStates;
+        std::minstd_rand m_samplingRandom{ std::random_device{}() };
+
+        // ring buffer of span events (sized when the first one is recorded)
+        std::vector<TraceEvent> m_traceEvents;
+        size_t m_nextTraceEvent{ 0 };
+        size_t m_traceEventCount{ 0 };
+        // the thread's ID in the exported trace
+        uint32_t m_traceThreadId{ 0 };
+        };
+
+    /// Records a span event into the calling thread's ring buffer (if tracing is enabled).
+    void RecordSpanEvent(const char phase, const char* name,
+                         const std::chrono::steady_clock::time_point timestamp,
+                         const std::chrono::steady_clock::duration duration,
+                         const SpanArguments& arguments);
+
+    /// The staging buffers that a thread has logged into (one for each logger),
+    /// which are marked as exited when the thread ends.
+    struct ThreadStagingCache
+        {
+        struct Entry
+            {
+            uint64_t m_loggerId{ 0 };
+            // only used while the logger is being called (which keeps its buffers alive)
+            StagingBuffer* m_buffer{ nullptr };
+            // whether the logger (and so the buffer) is still around
+            std::weak_ptr<StagingBuffer> m_sharedBuffer;
+            };
+        ~ThreadStagingCache()
+            {
+            for (const auto& entry : m_entries)
+                {
+                if (const auto buffer = entry.m_sharedBuffer.lock())
+                    { buffer->m_threadExited = true; }
+                }
+            }
+        std::vector<Entry> m_entries;
+        };
+
+    /// @returns The calling thread's staging buffer, creating it if needed.
+    StagingBuffer& GetStagingBuffer();
+    /// Marks the start of a record that is about to be appended to a staging buffer.
+    /// @note The staging buffer's mutex must be locked by the caller.
+    void BeginRecord(StagingBuffer& staging, const time_t timestamp, const wxLogLevel level)
+        { staging.m_records.push_back({ staging.m_data.length(), timestamp, m_recordSequence++, level }); }
+    /** @brief Accounts for the record that was just appended to a staging buffer,
+            or drops it if the hard limit is reached and the policy is to drop the newest records.
+        @note The staging buffer's mutex must be locked by the caller.
+        @returns @c false if the record was dropped.*/
+    bool CommitRecord(StagingBuffer& staging);
+    /// @returns The index of a level in the per-level record counts.
+    [[nodiscard]] static constexpr size_t GetStatisticsLevelIndex(const wxLogLevel level) noexcept
+        { return std::min<size_t>(level, wxLOG_Trace + 1); }
+    /// Adds the time that a write to the log file took to the statistics.
+    void RecordFlushLatency(const std::chrono::steady_clock::duration latency);
+    /// Enforces the buffer limits after a record was logged.
+    /// @note No staging buffer's mutex should be locked by the caller.
+    void ApplyBufferLimits();
+    /// Drops records, least severe levels first, until the queued records are under the hard limit.
+    void DropLowestLevelRecords();
+    /// Merges the staging buffers and writes them (or hands them to the writer thread).
+    void FlushPending();
+    /// Sends the records merged since the last call to the sinks.
+    /// @note The flush mutex must be locked by the caller.
+    void SendToSinks();
+    /// Empties the merged records (after they are written).
+    /// @note The flush mutex must be locked by the caller.
+    void ClearBuffer();
+
+    /// @returns A hash of a record's level, message and call site.
+    [[nodiscard]] static uint64_t HashRecord(const wxLogLevel level, const wxString& msg,
+                                             const char* filePath, const char* func,
+                                             const int line) noexcept;
+    /** @brief Checks whether a record is a copy of the last one that its thread logged,
+            counting it if so.
+        @returns @c true if the record is a duplicate and should be skipped.
+        @note The staging buffer's mutex must be locked by the caller.*/
+    bool IsDuplicateRecord(StagingBuffer& staging, const wxLogLevel level, const uint64_t recordHash,
+                           const time_t timestamp);
+    /** @brief Notes that a record is about to be logged, logging how many times
+            the previous record was repeated first (if it was).
+        @note The staging buffer's mutex must be locked by the caller.*/
+    void BeginUniqueRecord(StagingBuffer& staging, const wxLogLevel level, const uint64_t recordHash);
+    /// Logs how many times the last record in a staging buffer was repeated (if it was).
+    /// @note The staging buffer's mutex must be locked by the caller.
+    void AppendRepeatNotice(StagingBuffer& staging);
+    /** @brief Checks a call site's rate limit, logging how many of its records were
+            discarded if it is allowed to log again.
+        @returns @c true if the record should be discarded.
+        @note The staging buffer's mutex must be locked by the caller.*/
+    bool IsRateLimited(StagingBuffer& staging, const wxLogLevel level, const wxLogRecordInfo& info);
+    /** @brief Decides whether a debug or trace record is kept by the sampling policy.
+        @returns @c true if the record shouldn't be logged now (because it was either
+            discarded or is being held in a reservoir).
+        @note The staging buffer's mutex must be locked by the caller.*/
+    bool IsSampledOut(StagingBuffer& staging, const wxLogLevel level,
+                      const wxString& msg, const wxLogRecordInfo& info);
+    /** @brief Logs the records held in a thread's reservoirs whose intervals have ended.
+        @param staging The thread's staging buffer.
+        @param releaseAll @c true to log all of the held records, even if their intervals haven't ended.
+        @note The staging buffer's mutex must be locked by the caller.*/
+    void ReleaseSampledRecords(StagingBuffer& staging, const bool releaseAll);
+    /// Stages the records held in a reservoir as a run of their own, in the order that they were logged.
+    /// @note The staging buffer's mutex must be locked by the caller.
+    void ReleaseReservoir(StagingBuffer& staging, SamplingState& state);
+    /** @brief Formats a record into a staging buffer.
+        @returns @c false if the record was dropped because of the buffer limits.
+        @note The staging buffer's mutex must be locked by the caller.*/
+    bool AppendRecord(StagingBuffer& staging, const wxLogLevel level,
+                      const wxString& msg, const wxLogRecordInfo& info);
+    /// Copies encoded records into the crash ring (if it is enabled).
+    void AppendToCrashRing(const char* data, const size_t length);
+    /// @returns How much has been written to the crash ring.
+    [[nodiscard]] uint64_t GetCrashRingPosition();
+    /// Notes that everything written to the crash ring before @c position is in the log file.
+    void MarkCrashRingFlushed(const uint64_t position);
+    /// Recovers the records from a crashed session's ring file that didn't make it into its log file.
+    /// @returns @c true if anything was recovered.
+    bool RecoverCrashRing();
+    /// Copies encoded records into the emergency buffers (if the emergency flush is enabled).
+    void AppendToEmergencyBuffer(const char* data, const size_t length);
+    /// @returns How much has been copied into the emergency buffers.
+    [[nodiscard]] uint64_t GetEmergencyPosition();
+    /// Notes that everything copied into the emergency buffers before @c position is in the log file.
+    void MarkEmergencyBufferWritten(const uint64_t position) noexcept;
+    /// Points the emergency flush's file descriptor at the log file that was just opened.
+    /// @note The file mutex must be locked by the caller.
+    void UpdateEmergencyFileDescriptor();
+    /// Writes the unwritten part of the emergency buffers to the log file.
+    /// @note This is called from the signal handler, so it is async-signal-safe.
+    void WriteEmergencyBuffers() noexcept;
+    /// Constructor, which recovers the crash ring of a session that used the same ring file.
+    wxLogFile(const wxString& logFilePath, const wxString& crashRingPath);
+    /// @returns The application's log file, dated today.
+    [[nodiscard]] static wxString GetDefaultLogFilePath();
+    /// @returns The application's crash ring file.
+    [[nodiscard]] static wxString GetDefaultCrashRingPath();
+    /// The signal handler installed by EnableEmergencyFlush().
+    static void OnFatalSignal(int signalNumber);
+    /// Appends a note (e.g., about suppressed records) to a staging buffer as its own record.
+    /// @note The staging buffer's mutex must be locked by the caller.
+    void AppendNotice(StagingBuffer& staging, const wxLogLevel level,
+                      const time_t timestamp, const wxString& notice);
+    /// Moves the records from every thread's staging buffer into the pending
+    /// buffer, ordered by timestamp.
+    /// @note The flush mutex must be locked by the caller.
+    void MergeStagingBuffers();
+
+    /// @returns The prefix shown in front of a message for the given level.
+    [[nodiscard]] static const char* GetLevelPrefix(const wxLogLevel level) noexcept;
+    /// @returns A record formatted as a line of text.
+    [[nodiscard]] static wxString FormatRecord(const wxLogLevel level, const wxString& msg,
+                                               const time_t timestamp, const wxString& func,
+                                               const wxString& filePath, const int line);
+    /// Appends a record to a staging buffer as a line of text.
+    /// @note This is the same layout as FormatRecord(), but built directly
+    ///     into the buffer without any temporary strings.
+    static void AppendTextRecord(StagingBuffer& staging, const wxLogLevel level,
+                                 const wxString& msg, const wxLogRecordInfo& info);
+    /// @returns The ID of a function or file name, queueing its definition to be
+    ///     written if it hasn't been seen before.
+    uint32_t InternString(StagingBuffer& staging, const char* str);
+
+    // each thread's records that haven't been flushed yet
+    std::vector<std::shared_ptr<StagingBuffer>> m_stagingBuffers;
+    std::mutex m_stagingBuffersMutex;
+    std::atomic<uint64_t> m_recordSequence{ 0 };
+
+    // limits on the staged records
+    std::atomic<size_t> m_queuedBytes{ 0 };
+    std::atomic<size_t> m_highWaterMark{ 0 };
+    std::atomic<size_t> m_hardLimit{ 0 };
+    std::atomic<DropPolicy> m_dropPolicy{ DropPolicy::DropLowestLevelFirst };
+    std::atomic<uint64_t> m_droppedRecords{ 0 };
+    // dropped records not yet noted in the log
+    std::atomic<uint64_t> m_unreportedDroppedRecords{ 0 };
+    std::mutex m_dropMutex;
+
+    // duplicate suppression and rate limiting
+    std::atomic<bool> m_suppressDuplicates{ false };
+    /// A call site's token bucket.
+    struct RateLimitBucket
+        {
+        double m_tokens{ 0 };
+        std::chrono::steady_clock::time_point m_lastRefill;
+        uint64_t m_discardedRecords{ 0 };
+        };
+    std::atomic<bool> m_rateLimited{ false };
+    double m_rateLimitPerSecond{ 0 };
+    double m_rateLimitBurst{ 0 };
+    // keyed on the hash of the call site's file name (a string literal) and line
+    std::unordered_map<uint64_t, RateLimitBucket> m_rateLimitBuckets;
+    std::mutex m_rateLimitMutex;
+    std::atomic<uint64_t> m_rateLimitedRecords{ 0 };
+
+    // sampling (the per-call site state is kept in each thread's staging buffer)
+    std::atomic<SamplingPolicy> m_samplingPolicy{ SamplingPolicy::KeepAll };
+    std::atomic<size_t> m_sampleSize{ 100 };
+    std::atomic<std::chrono::steady_clock::duration> m_samplingInterval{ std::chrono::seconds(1) };
+    std::atomic<uint64_t> m_sampledOutRecords{ 0 };
+
+    // statistics about writing to the file
+    std::mutex m_statisticsMutex;
+    uint64_t m_bytesWritten{ 0 };
+    uint64_t m_flushCount{ 0 };
+    // how many writes took [2^i, 2^(i+1)) microseconds (with the first bucket also holding 0)
+    std::array<uint64_t, 40> m_flushLatencyHistogram{};
+    std::chrono::microseconds m_flushLatencyMax{ 0 };
+    // record counts from the staging buffers of threads that have exited
+    std::array<uint64_t, wxLOG_Trace + 2> m_retiredRecordsPerLevel{};
+
+    // spans
+    std::atomic<bool> m_tracing{ false };
+    std::atomic<size_t> m_traceCapacity{ 65536 };
+    const std::chrono::steady_clock::time_point m_traceEpoch{ std::chrono::steady_clock::now() };
+    uint32_t m_traceThreadCount{ 0 };
+
+    // crash ring
+    wxString m_crashRingPath;
+    wxString m_recoveredLogFilePath;
+    wxMappedFile m_crashRing;
+    std::mutex m_crashRingMutex;
+    std::atomic<bool> m_crashRingEnabled{ false };
+    // the locked lock file, held while the ring is in use
+    int m_crashRingLockDescriptor{ -1 };
+
+    // emergency flush
+    struct EmergencyBuffer
+        {
+        std::unique_ptr<char[]> m_data;
+        // the emergency position of the first byte, and how many bytes are in use
+        // (read by the signal handler, so they are lock-free atomics)
+        std::atomic<uint64_t> m_start{ 0 };
+        std::atomic<size_t> m_length{ 0 };
+        };
+    std::array<EmergencyBuffer, 2> m_emergencyBuffers;
+    size_t m_emergencyBufferSize{ 0 };
+    size_t m_activeEmergencyBuffer{ 0 };
+    // total bytes copied into the buffers, and how many of those are in the log file
+    uint64_t m_emergencyPosition{ 0 };
+    std::atomic<uint64_t> m_emergencyWrittenPosition{ 0 };
+    // a duplicate of the log file's descriptor, opened ahead of time for the signal handler
+    std::atomic<int> m_emergencyFileDescriptor{ -1 };
+    std::mutex m_emergencyMutex;
+    std::atomic<bool> m_emergencyFlushEnabled{ false };
+    // the logger whose buffers the signal handler writes (only one can be installed)
+    inline static std::atomic<wxLogFile*> m_emergencyLogger{ nullptr };
+    // tells this logger's staging buffers apart from other loggers' in the thread caches
+    const uint64_t m_loggerId{ ++m_loggerCount };
+    inline static std::atomic<uint64_t> m_loggerCount{ 0 };
+
+    // merged records waiting to be written
+    std::mutex m_flushMutex;
+    std::string m_buffer;
+    bool m_bufferHasError{ false };
+    // where the records in the merged buffer are (only tracked when there are sinks
+    // or a search index), and how much of the buffer was already sent to the sinks
+    std::vector<wxLogFileBatch::Record> m_bufferRecords;
+    size_t m_sentBufferLength{ 0 };
+    size_t m_sentBufferRecords{ 0 };
+
+    // other destinations for the records
+    std::vector<std::shared_ptr<wxLogFileSink>> m_sinks;
+    std::atomic<bool> m_hasSinks{ false };
     wxString m_logFilePath;
+    // the file is created when it's first written to
+    std::atomic<bool> m_logFilePending{ true };
+    // whether the current problem with the file was already reported
+    bool m_fileErrorReported{ false };
+    ErrorHandler m_errorHandler;
+    wxString m_lastError;
+    std::mutex m_errorMutex;
+
+    // the log file, held open for the lifetime of the logger
+    wxFile m_logFile;
+    mutable std::mutex m_fileMutex;
+    // (read by the writer thread without the file mutex)
+    std::atomic<SyncPolicy> m_syncPolicy{ SyncPolicy::Never };
+    std::atomic<std::chrono::milliseconds> m_syncInterval{ std::chrono::milliseconds(1000) };
+    std::chrono::steady_clock::time_point m_lastSync{ std::chrono::steady_clock::now() };
+    bool m_hasUnsyncedData{ false };
+    wxFileOffset m_logFileSize{ 0 };
+    // how much of a block that failed to write made it into the file anyway; the block is
+    // retried (with anything merged since appended to it), so that much of it is skipped
+    size_t m_partialBlockLength{ 0 };
+
+    // word index of the log file (updated by whichever thread writes to the file,
+    // after unlocking the file)
+    wxLogFileIndex m_searchIndex;
+    std::atomic<bool> m_searchIndexEnabled{ false };
+
+    // rotation
+    wxFileOffset m_rotationFileSize{ 0 };
+    std::chrono::seconds m_rotationInterval{ 0 };
+    size_t m_rotationGenerations{ 5 };
+    std::chrono::steady_clock::time_point m_logFileCreated{ std::chrono::steady_clock::now() };
+    // rotated files are numbered until they are compressed into the first generation
+    uint64_t m_rotationCount{ 0 };
+    // rotated files waiting to be compressed, and the thread that compresses them
+    // (and shifts the generations, which nothing else touches)
+    std::deque<RotatedFile> m_compressionQueue;
+    std::thread m_compressionThread;
+    std::mutex m_compressionMutex;
+    std::condition_variable m_compressionQueued;
+    bool m_stopCompression{ false };
+    // held while the generations are shifted, so that searches don't see them half-moved
+    mutable std::mutex m_generationsMutex;
+
+    // binary records
+    // (read by every logging thread, with only its staging buffer locked)
+    std::atomic<RecordFormat> m_recordFormat{ RecordFormat::Text };
+    // function and file names are string literals, so they can be interned by address
+    std::unordered_map<const char*, uint32_t> m_internedStrings;
+    std::atomic<uint64_t> m_internGeneration{ 1 };
+    // definitions that haven't been merged into the pending buffer yet
+    std::string m_pendingDefinitions;
+    // all string definitions, repeated at the top of each new file after a rotation
+    std::string m_stringDefinitions;
+    std::mutex m_stringDefinitionsMutex;
+
+    // asynchronous writing
+    std::thread m_writerThread;
+    std::mutex m_queueMutex;
+    std::condition_variable m_queueNotEmpty;
+    std::condition_variable m_queueNotFull;
+    std::condition_variable m_queueDrained;
+    std::deque<PendingBlock> m_writeQueue;
+    // memory from a written block, handed back for the next batch
+    std::string m_recycledBuffer;
+    size_t m_maxQueuedBlocks{ 64 };
+    // block popped from the queue that the writer thread is still writing
+    bool m_writingBlock{ false };
+    // blocks at the front of the queue that couldn't be written, which are only
+    // tried again along with the next one queued (like the next flush in synchronous mode)
+    size_t m_failedBlocks{ 0 };
+    bool m_stopWriter{ false };
+    // changed under the flush mutex, so a flush never queues a block for a stopped writer thread
+    std::atomic<bool> m_asyncWriting{ false };
+
     wxDECLARE_NO_COPY_CLASS(wxLogFile);
     };
 
+/** @brief Records a span from its construction until it goes out of scope.
+    @par Example:
+    @code
+    void LoadProject(const wxString& filePath)
+        {
+        wxLogFileSpan span(*logFile, "LoadProject", { { L"file", filePath } });
+        ...
+        }
+    @endcode
+    @note Nothing is timed if the logger isn't tracing when the span is constructed.*/
+class wxLogFileSpan
+    {
+public:
+    /** @brief Constructor, which starts the span.
+        @param logFile The logger to record the span in.
+        @param name The name of the span (in UTF-8). This must outlive the span
+            (e.g., a string literal).
+        @param arguments Values to show with the span.*/
+    wxLogFileSpan(wxLogFile& logFile, const char* name,
+                  wxLogFile::SpanArguments arguments = wxLogFile::SpanArguments{}) :
+        m_logFile(logFile.IsTracing() ? &logFile : nullptr), m_name(name),
+        m_arguments(std::move(arguments))
+        {
+        if (m_logFile != nullptr)
+            { m_start = std::chrono::steady_clock::now(); }
+        }
+    /// Destructor, which ends the span.
+    ~wxLogFileSpan()
+        {
+        if (m_logFile != nullptr)
+            { m_logFile->AddSpan(m_name, m_start, std::chrono::steady_clock::now(), m_arguments); }
+        }
+private:
+    wxLogFile* m_logFile{ nullptr };
+    const char* m_name{ nullptr };
+    wxLogFile::SpanArguments m_arguments;
+    std::chrono::steady_clock::time_point m_start;
+
+    wxDECLARE_NO_COPY_CLASS(wxLogFileSpan);
+    };
+
 /** @}*/
 
 #endif //__WXLOGFILLE_H__
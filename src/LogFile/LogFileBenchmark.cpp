@@ -0,0 +1,268 @@
+/* copyright (c) Oleander Software, Ltd.
+   author: Blake Madden
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the BSD License.
+*/
+
+#include "LogFileBenchmark.h"
+#include <wx/datetime.h>
+#include <wx/filename.h>
+#include <mutex>
+#include <string>
+
+namespace
+    {
+    // formats records the way that wxLogFile did before it built text records in place
+    // (with wxString::Format() and a temporary UTF-8 copy of each one), into memory
+    class BaselineFormattingLog final : public wxLog
+        {
+    protected:
+        void DoLogRecord(wxLogLevel level, const wxString& msg, const wxLogRecordInfo& info) final
+            {
+            const char* prefix = (level == wxLOG_Debug || level == wxLOG_Trace) ? "Debug: " :
+                (level == wxLOG_Error || level == wxLOG_FatalError) ? "Error: " :
+                (level == wxLOG_Warning) ? "Warning: " : "";
+            const wxString text = wxString::Format(L"%s%s\t%s\t%s\t%s: line %d\n",
+                prefix, msg, wxDateTime(info.timestamp).FormatISOCombined(' '),
+                (info.func ? wxString(info.func) : L"NA"),
+                (info.filename ? wxFileName(info.filename).GetFullName() : L"NA"),
+                info.line);
+            const auto utf8 = text.utf8_str();
+            std::lock_guard<std::mutex> lock(m_mutex);
+            // (writing isn't what this measures, so the memory is just reused)
+            if (m_buffer.length() + utf8.length() > MAX_BUFFER_LENGTH)
+                { m_buffer.clear(); }
+            m_buffer.append(utf8.data(), utf8.length());
+            }
+    private:
+        static constexpr size_t MAX_BUFFER_LENGTH{ 1024 * 1024 };
+        std::mutex m_mutex;
+        std::string m_buffer;
+        };
+    }
+
+std::vector<wxLogFileBenchmark::Scenario> wxLogFileBenchmark::GetDefaultScenarios()
+    {
+    const size_t threadCount = std::max<size_t>(std::thread::hardware_concurrency(), 2);
+
+    std::vector<Scenario> scenarios;
+    Scenario scenario;
+    scenario.m_name = L"single-thread";
+    scenarios.push_back(scenario);
+
+    // the same records, only formatted the old way (an upper bound for the old logger to compare the above with)
+    scenario.m_name = L"single-thread-baseline-formatting";
+    scenario.m_baselineFormatting = true;
+    scenarios.push_back(scenario);
+    scenario.m_baselineFormatting = false;
+
+    scenario.m_name = L"multi-thread";
+    scenario.m_threadCount = threadCount;
+    scenario.m_recordsPerThread = 50000;
+    scenarios.push_back(scenario);
+
+    scenario.m_name = L"multi-thread-mixed-levels";
+    scenario.m_mixedLevels = true;
+    scenarios.push_back(scenario);
+
+    scenario = Scenario{};
+    scenario.m_name = L"large-messages";
+    scenario.m_recordsPerThread = 10000;
+    scenario.m_messageLength = 4096;
+    scenarios.push_back(scenario);
+
+    scenario = Scenario{};
+    scenario.m_name = L"forced-flushes";
+    scenario.m_recordsPerThread = 20000;
+    scenario.m_flushInterval = 10;
+    scenarios.push_back(scenario);
+
+    scenario = Scenario{};
+    scenario.m_name = L"binary-records";
+    scenario.m_recordFormat = wxLogFile::RecordFormat::Binary;
+    scenarios.push_back(scenario);
+
+    scenario = Scenario{};
+    scenario.m_name = L"async-writing-forced-flushes";
+    scenario.m_threadCount = threadCount;
+    scenario.m_recordsPerThread = 20000;
+    scenario.m_flushInterval = 100;
+    scenario.m_asyncWriting = true;
+    scenarios.push_back(scenario);
+
+    return scenarios;
+    }
+
+wxLogFileBenchmark::Result wxLogFileBenchmark::Run(const Scenario& scenario)
+    {
+    Result result;
+    result.m_scenario = scenario;
+
+    // log to a scratch file, rather than the application's own log (which a logger clears
+    // when it first flushes), and leave the crash ring and emergency flush off
+    const wxString scratchFilePath = wxFileName::CreateTempFileName(
+        wxFileName::GetTempDir() + wxFileName::GetPathSeparator() + L"wxLogFileBenchmark");
+    if (scratchFilePath.empty())
+        { return result; }
+    auto logFile = std::make_unique<wxLogFile>(scratchFilePath);
+    logFile->SetRecordFormat(scenario.m_recordFormat);
+    logFile->EnableAsyncWriting(scenario.m_asyncWriting);
+    BaselineFormattingLog baselineLog;
+    wxLog* logger = scenario.m_baselineFormatting ? static_cast<wxLog*>(&baselineLog) : logFile.get();
+    wxLog* previousTarget = wxLog::SetActiveTarget(logger);
+
+    const size_t threadCount = std::max<size_t>(scenario.m_threadCount, 1);
+    std::vector<std::vector<uint64_t>> threadLatencies(threadCount);
+    const auto start = std::chrono::steady_clock::now();
+    if (threadCount == 1)
+        { LogRecords(scenario, *logger, 0, threadLatencies[0]); }
+    else
+        {
+        std::vector<std::thread> threads;
+        threads.reserve(threadCount);
+        for (size_t i = 0; i < threadCount; ++i)
+            {
+            threads.emplace_back([&scenario, logger, &threadLatencies, i]()
+                {
+                // log straight into the logger, rather than through the main thread
+                wxLog::SetThreadActiveTarget(logger);
+                LogRecords(scenario, *logger, i, threadLatencies[i]);
+                wxLog::SetThreadActiveTarget(nullptr);
+                });
+            }
+        for (auto& thread : threads)
+            { thread.join(); }
+        }
+    logFile->FlushAndWait();
+    result.m_elapsed = std::chrono::steady_clock::now() - start;
+
+    std::vector<uint64_t> latencies;
+    for (const auto& threadLatency : threadLatencies)
+        { latencies.insert(latencies.end(), threadLatency.cbegin(), threadLatency.cend()); }
+    std::sort(latencies.begin(), latencies.end());
+    result.m_recordCount = latencies.size();
+    result.m_latencyP50 = std::chrono::nanoseconds(GetPercentile(latencies, 0.5));
+    result.m_latencyP90 = std::chrono::nanoseconds(GetPercentile(latencies, 0.9));
+    result.m_latencyP99 = std::chrono::nanoseconds(GetPercentile(latencies, 0.99));
+    result.m_latencyP999 = std::chrono::nanoseconds(GetPercentile(latencies, 0.999));
+    result.m_latencyMax = std::chrono::nanoseconds(latencies.empty() ? 0 : latencies.back());
+    result.m_statistics = logFile->GetStatistics();
+
+    wxLog::SetActiveTarget(previousTarget);
+    logFile.reset();
+    wxRemoveFile(scratchFilePath);
+    return result;
+    }
+
+std::vector<wxLogFileBenchmark::Result> wxLogFileBenchmark::RunAll(const std::vector<Scenario>& scenarios)
+    {
+    std::vector<Result> results;
+    results.reserve(scenarios.size());
+    for (const auto& scenario : scenarios)
+        { results.push_back(Run(scenario)); }
+    return results;
+    }
+
+void wxLogFileBenchmark::LogRecords(const Scenario& scenario, wxLog& logger,
+                                    const size_t threadIndex, std::vector<uint64_t>& latencies)
+    {
+    constexpr wxLogLevel MIXED_LEVELS[] = { wxLOG_Error, wxLOG_Warning, wxLOG_Message, wxLOG_Debug };
+    const wxString message(wxUniChar(L'a' + (threadIndex % 26)), scenario.m_messageLength);
+
+    latencies.clear();
+    latencies.reserve(scenario.m_recordsPerThread);
+    for (size_t i = 0; i < scenario.m_recordsPerThread; ++i)
+        {
+        const wxLogLevel level = scenario.m_mixedLevels ?
+            MIXED_LEVELS[i % std::size(MIXED_LEVELS)] : static_cast<wxLogLevel>(wxLOG_Message);
+        const auto callStart = std::chrono::steady_clock::now();
+        wxLogGeneric(level, L"%s %lu", message, static_cast<unsigned long>(i));
+        latencies.push_back(static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - callStart).count()));
+        if (scenario.m_flushInterval > 0 && (i + 1) % scenario.m_flushInterval == 0)
+            { logger.Flush(); }
+        }
+    }
+
+uint64_t wxLogFileBenchmark::GetPercentile(const std::vector<uint64_t>& sortedValues,
+                                           const double percentile) noexcept
+    {
+    if (sortedValues.empty())
+        { return 0; }
+    const auto index = static_cast<size_t>(percentile * static_cast<double>(sortedValues.size() - 1));
+    return sortedValues[std::min(index, sortedValues.size() - 1)];
+    }
+
+wxString wxLogFileBenchmark::EscapeJSON(const wxString& str)
+    {
+    wxString escaped;
+    escaped.reserve(str.length());
+    for (const auto ch : str)
+        {
+        if (ch == L'"' || ch == L'\\')
+            { escaped << L'\\' << ch; }
+        else if (ch < 0x20)
+            { escaped << wxString::Format(L"\\u%04x", static_cast<unsigned int>(ch)); }
+        else
+            { escaped << ch; }
+        }
+    return escaped;
+    }
+
+wxString wxLogFileBenchmark::FormatAsJSON(const std::vector<Result>& results)
+    {
+    const auto count = [](const uint64_t value)
+        { return wxString::Format(L"%llu", static_cast<unsigned long long>(value)); };
+    const auto nanoseconds = [&count](const std::chrono::nanoseconds value)
+        { return count(static_cast<uint64_t>(value.count())); };
+    const auto microseconds = [&count](const std::chrono::microseconds value)
+        { return count(static_cast<uint64_t>(value.count())); };
+
+    wxString json;
+    json << L"{\n  \"wx_version\": \"" << EscapeJSON(wxVERSION_NUM_DOT_STRING) << L"\",\n"
+         << L"  \"benchmarks\": [";
+    for (size_t i = 0; i < results.size(); ++i)
+        {
+        const Result& result = results[i];
+        const Scenario& scenario = result.m_scenario;
+        json << (i == 0 ? L"\n" : L",\n")
+             << L"    {\n"
+             << L"      \"name\": \"" << EscapeJSON(scenario.m_name) << L"\",\n"
+             << L"      \"threads\": " << count(scenario.m_threadCount) << L",\n"
+             << L"      \"records_per_thread\": " << count(scenario.m_recordsPerThread) << L",\n"
+             << L"      \"message_length\": " << count(scenario.m_messageLength) << L",\n"
+             << L"      \"mixed_levels\": " << (scenario.m_mixedLevels ? L"true" : L"false") << L",\n"
+             << L"      \"flush_interval\": " << count(scenario.m_flushInterval) << L",\n"
+             << L"      \"record_format\": \""
+                << (scenario.m_recordFormat == wxLogFile::RecordFormat::Binary ? L"binary" : L"text") << L"\",\n"
+             << L"      \"async_writing\": " << (scenario.m_asyncWriting ? L"true" : L"false") << L",\n"
+             << L"      \"baseline_formatting\": " << (scenario.m_baselineFormatting ? L"true" : L"false") << L",\n"
+             << L"      \"records\": " << count(result.m_recordCount) << L",\n"
+             << L"      \"elapsed_ns\": " << nanoseconds(result.m_elapsed) << L",\n"
+             // (not using Format() here, as the decimal separator would follow the locale)
+             << L"      \"records_per_second\": " << wxString::FromCDouble(result.GetRecordsPerSecond(), 1) << L",\n"
+             << L"      \"latency_ns\": { "
+                << L"\"p50\": " << nanoseconds(result.m_latencyP50)
+                << L", \"p90\": " << nanoseconds(result.m_latencyP90)
+                << L", \"p99\": " << nanoseconds(result.m_latencyP99)
+                << L", \"p999\": " << nanoseconds(result.m_latencyP999)
+                << L", \"max\": " << nanoseconds(result.m_latencyMax) << L" },\n"
+             << L"      \"bytes_written\": " << count(result.m_statistics.m_bytesWritten) << L",\n"
+             << L"      \"flush_count\": " << count(result.m_statistics.m_flushCount) << L",\n"
+             << L"      \"flush_latency_us\": { "
+                << L"\"p50\": " << microseconds(result.m_statistics.m_flushLatencyP50)
+                << L", \"p99\": " << microseconds(result.m_statistics.m_flushLatencyP99)
+                << L", \"max\": " << microseconds(result.m_statistics.m_flushLatencyMax) << L" },\n"
+             << L"      \"dropped_records\": " << count(result.m_statistics.m_droppedRecords) << L"\n"
+             << L"    }";
+        }
+    json << L"\n  ]\n}\n";
+    return json;
+    }
+
+bool wxLogFileBenchmark::WriteJSON(const wxString& filePath, const std::vector<Result>& results)
+    {
+    wxFile file(filePath, wxFile::write);
+    return file.IsOpened() && file.Write(FormatAsJSON(results), wxConvUTF8);
+    }
@@ -0,0 +1,142 @@
+/** @addtogroup wxCode
+    @brief A collection of wxWidget tools.
+    @date 2005-2021
+    @copyright Oleander Software, Ltd.
+    @author Blake Madden
+    @details This program is free software; you can redistribute it and/or modify
+    it under the terms of the BSD License.
+* @{*/
+
+#ifndef __WXLOGFILE_BENCHMARK_H__
+#define __WXLOGFILE_BENCHMARK_H__
+
+#include <wx/wx.h>
+#include <wx/string.h>
+#include <wx/log.h>
+#include <wx/file.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "LogFile.h"
+
+/** @brief Measures how fast wxLogFile logs and writes records.
+
+    Each scenario logs through a new wxLogFile (routed through the regular @c wxLog*
+    functions, like an application would) and reports the throughput, how long each
+    logging call took and how much was written. The results can be formatted as JSON,
+    so that runs from different versions can be diffed. Each logger writes to its own
+    scratch file (which is deleted afterwards), so the application's log isn't touched.
+
+    Nothing here needs a GUI, so the benchmarks can be run from a console program:
+
+    @code
+    int main(int argc, char** argv)
+        {
+        wxInitializer initializer(argc, argv);
+        if (!initializer.IsOk())
+            { return 1; }
+        const auto results = wxLogFileBenchmark::RunAll(wxLogFileBenchmark::GetDefaultScenarios());
+        return wxLogFileBenchmark::WriteJSON(L"logfile-benchmark.json", results) ? 0 : 1;
+        }
+    @endcode
+
+    @note Each logging call is timed individually, so the latencies include the
+        (small) cost of reading the clock.*/
+class wxLogFileBenchmark
+    {
+public:
+    /// @brief How a benchmark logs its records.
+    struct Scenario
+        {
+        /// The name of the benchmark (used to identify it in the results).
+        wxString m_name;
+        /// The number of threads logging at the same time.
+        size_t m_threadCount{ 1 };
+        /// The number of records that each thread logs.
+        size_t m_recordsPerThread{ 100000 };
+        /// The length (in characters) of each message.
+        size_t m_messageLength{ 64 };
+        /// @c true to cycle through errors, warnings, messages and debug messages,
+        ///     @c false to only log messages.
+        bool m_mixedLevels{ false };
+        /// If not @c 0, each thread flushes the log after logging this many records.
+        size_t m_flushInterval{ 0 };
+        /// Whether the log is written as text or binary records.
+        wxLogFile::RecordFormat m_recordFormat{ wxLogFile::RecordFormat::Text };
+        /// @c true to write the log from wxLogFile's writer thread.
+        bool m_asyncWriting{ false };
+        /// @c true to only format each record the way that wxLogFile used to (with @c wxString::Format()
+        ///     and a temporary UTF-8 copy), into memory, instead of logging it through wxLogFile.
+        /// @note This doesn't write anything, so its records per second are an upper
+        ///     bound for the old formatting to compare the current logger against.
+        bool m_baselineFormatting{ false };
+        };
+
+    /// @brief The measurements from running a scenario.
+    struct Result
+        {
+        /// The scenario that was run.
+        Scenario m_scenario;
+        /// The total number of records logged.
+        uint64_t m_recordCount{ 0 };
+        /// How long it took to log all of the records and write them to the log file.
+        std::chrono::nanoseconds m_elapsed{ 0 };
+        /// @{
+        /// How long the individual logging calls took.
+        std::chrono::nanoseconds m_latencyP50{ 0 };
+        std::chrono::nanoseconds m_latencyP90{ 0 };
+        std::chrono::nanoseconds m_latencyP99{ 0 };
+        std::chrono::nanoseconds m_latencyP999{ 0 };
+        std::chrono::nanoseconds m_latencyMax{ 0 };
+        /// @}
+        /// The logger's own statistics at the end of the run.
+        wxLogFile::Statistics m_statistics;
+
+        /// @returns The number of records logged per second.
+        [[nodiscard]] double GetRecordsPerSecond() const noexcept
+            {
+            return (m_elapsed.count() > 0) ?
+                static_cast<double>(m_recordCount) * 1e9 / static_cast<double>(m_elapsed.count()) : 0;
+            }
+        };
+
+    /// @returns The standard set of benchmarks: a single thread (with the current and the
+    ///     baseline text formatting), several threads, mixed levels, large messages,
+    ///     frequent flushes, binary records and asynchronous writing.
+    [[nodiscard]] static std::vector<Scenario> GetDefaultScenarios();
+    /// @returns The measurements from running a scenario.
+    /// @param scenario The scenario to run.
+    [[nodiscard]] static Result Run(const Scenario& scenario);
+    /// @returns The measurements from running each scenario (in order).
+    /// @param scenarios The scenarios to run.
+    [[nodiscard]] static std::vector<Result> RunAll(const std::vector<Scenario>& scenarios);
+
+    /// @returns The results, formatted as JSON.
+    /// @param results The results to format.
+    [[nodiscard]] static wxString FormatAsJSON(const std::vector<Result>& results);
+    /** @brief Writes the results to a file as JSON.
+        @param filePath The file to write to.
+        @param results The results to write.
+        @returns @c true if the file was written.*/
+    static bool WriteJSON(const wxString& filePath, const std::vector<Result>& results);
+private:
+    /** @brief Logs a thread's share of a scenario's records.
+        @param scenario The scenario being run.
+        @param logger The logger to log to.
+        @param threadIndex The index of the thread (used to vary the messages).
+        @param[out] latencies How long each logging call took, in nanoseconds.*/
+    static void LogRecords(const Scenario& scenario, wxLog& logger,
+                           const size_t threadIndex, std::vector<uint64_t>& latencies);
+    /// @returns A value from sorted values at a percentile (e.g., @c 0.99).
+    [[nodiscard]] static uint64_t GetPercentile(const std::vector<uint64_t>& sortedValues,
+                                                const double percentile) noexcept;
+    /// @returns A string with the characters that JSON reserves escaped.
+    [[nodiscard]] static wxString EscapeJSON(const wxString& str);
+    };
+
+/** @}*/
+
+#endif //__WXLOGFILE_BENCHMARK_H__
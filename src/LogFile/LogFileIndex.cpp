@@ -0,0 +1,491 @@
+/* copyright (c) Oleander Software, Ltd.
+   author: Blake Madden
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the BSD License.
+*/
+
+#include "LogFileIndex.h"
+#include "LogFile.h"
+
+namespace
+    {
+    // header at the start of an index file
+    constexpr char INDEX_MAGIC[] = { 'W', 'X', 'L', 'O', 'G', 'I', '0', '1' };
+    // header at the start of a compacted index file
+    constexpr char COMPACTED_INDEX_MAGIC[] = { 'W', 'X', 'L', 'O', 'G', 'C', '0', '1' };
+    // sizes of a compacted index's header, its records, and its words' entries
+    constexpr size_t COMPACTED_HEADER_LENGTH = sizeof(COMPACTED_INDEX_MAGIC) + sizeof(uint32_t) * 2 + sizeof(uint64_t);
+    constexpr size_t COMPACTED_RECORD_LENGTH = sizeof(uint64_t) + sizeof(int64_t) + sizeof(uint32_t);
+    constexpr size_t COMPACTED_WORD_LENGTH = (sizeof(uint64_t) + sizeof(uint32_t)) * 2;
+    // longer words are only indexed by their start
+    constexpr size_t MAX_WORD_LENGTH = 64;
+
+    template<typename T>
+    void AppendValue(std::string& buffer, const T value)
+        { buffer.append(reinterpret_cast<const char*>(&value), sizeof(T)); }
+
+    template<typename T>
+    [[nodiscard]] bool ReadValue(const char*& pos, const char* end, T& value)
+        {
+        if (static_cast<size_t>(end - pos) < sizeof(T))
+            { return false; }
+        std::memcpy(&value, pos, sizeof(T));
+        pos += sizeof(T);
+        return true;
+        }
+
+    // letters and digits (in any script, as UTF-8 lead and continuation bytes are included) and underscores
+    [[nodiscard]] constexpr bool IsWordCharacter(const unsigned char ch) noexcept
+        {
+        return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') ||
+               (ch >= '0' && ch <= '9') || ch == '_' || ch >= 0x80;
+        }
+
+    // intersects the records that contain each word, starting with the rarest word
+    // (with no words, every record matches)
+    [[nodiscard]] std::vector<uint32_t> IntersectPostings(std::vector<const std::vector<uint32_t>*>& wordPostings,
+                                                          const size_t recordCount)
+        {
+        std::vector<uint32_t> candidates;
+        if (wordPostings.empty())
+            {
+            candidates.resize(recordCount);
+            for (size_t i = 0; i < candidates.size(); ++i)
+                { candidates[i] = static_cast<uint32_t>(i); }
+            return candidates;
+            }
+        std::sort(wordPostings.begin(), wordPostings.end(),
+            [](const auto first, const auto second) noexcept
+            { return first->size() < second->size(); });
+        candidates = *wordPostings.front();
+        std::vector<uint32_t> intersection;
+        for (size_t i = 1; i < wordPostings.size() && !candidates.empty(); ++i)
+            {
+            intersection.clear();
+            std::set_intersection(candidates.cbegin(), candidates.cend(),
+                                  wordPostings[i]->cbegin(), wordPostings[i]->cend(),
+                                  std::back_inserter(intersection));
+            candidates.swap(intersection);
+            }
+        return candidates;
+        }
+
+    // the sections of a mapped, compacted index file
+    class CompactedIndexView
+        {
+    public:
+        // @returns false if the file isn't a compacted index (or is cut short)
+        bool Read(const char* data, const size_t length)
+            {
+            const char* pos = data;
+            const char* const end = data + length;
+            if (length < COMPACTED_HEADER_LENGTH ||
+                std::memcmp(data, COMPACTED_INDEX_MAGIC, sizeof(COMPACTED_INDEX_MAGIC)) != 0)
+                { return false; }
+            pos += sizeof(COMPACTED_INDEX_MAGIC);
+            uint64_t wordPoolLength{ 0 };
+            if (!ReadValue(pos, end, m_recordCount) || !ReadValue(pos, end, m_wordCount) ||
+                !ReadValue(pos, end, wordPoolLength))
+                { return false; }
+            const uint64_t remaining = static_cast<uint64_t>(end - pos);
+            const uint64_t tablesLength = static_cast<uint64_t>(m_recordCount) * COMPACTED_RECORD_LENGTH +
+                                          static_cast<uint64_t>(m_wordCount) * COMPACTED_WORD_LENGTH;
+            if (tablesLength > remaining || wordPoolLength > remaining - tablesLength)
+                { return false; }
+            m_records = pos;
+            m_words = m_records + static_cast<size_t>(m_recordCount) * COMPACTED_RECORD_LENGTH;
+            m_wordPool = m_words + static_cast<size_t>(m_wordCount) * COMPACTED_WORD_LENGTH;
+            m_wordPoolLength = static_cast<size_t>(wordPoolLength);
+            m_postings = m_wordPool + m_wordPoolLength;
+            m_postingCount = static_cast<size_t>(end - m_postings) / sizeof(uint32_t);
+            return true;
+            }
+        // @returns a word (or an empty string if its entry is corrupt)
+        [[nodiscard]] std::string_view GetWord(const size_t index) const
+            {
+            const char* pos = m_words + index * COMPACTED_WORD_LENGTH;
+            uint64_t wordOffset{ 0 };
+            uint32_t wordLength{ 0 };
+            std::memcpy(&wordOffset, pos, sizeof(wordOffset));
+            std::memcpy(&wordLength, pos + sizeof(wordOffset), sizeof(wordLength));
+            return (wordOffset <= m_wordPoolLength && wordLength <= m_wordPoolLength - wordOffset) ?
+                std::string_view(m_wordPool + wordOffset, wordLength) : std::string_view{};
+            }
+        // @returns false if a word's postings are corrupt
+        bool GetPostings(const size_t index, std::vector<uint32_t>& postings) const
+            {
+            const char* pos = m_words + index * COMPACTED_WORD_LENGTH + sizeof(uint64_t) + sizeof(uint32_t);
+            uint64_t firstPosting{ 0 };
+            uint32_t postingCount{ 0 };
+            std::memcpy(&firstPosting, pos, sizeof(firstPosting));
+            std::memcpy(&postingCount, pos + sizeof(firstPosting), sizeof(postingCount));
+            if (firstPosting > m_postingCount || postingCount > m_postingCount - firstPosting)
+                { return false; }
+            postings.resize(postingCount);
+            if (postingCount > 0)
+                {
+                std::memcpy(postings.data(), m_postings + firstPosting * sizeof(uint32_t),
+                            postingCount * sizeof(uint32_t));
+                }
+            return std::all_of(postings.cbegin(), postings.cend(),
+                [this](const auto posting) noexcept { return posting < m_recordCount; });
+            }
+        // @returns the index of the first word that isn't less than @c word
+        [[nodiscard]] size_t LowerBound(const std::string_view word) const
+            {
+            size_t first{ 0 }, count{ m_wordCount };
+            while (count > 0)
+                {
+                const size_t step = count / 2;
+                if (GetWord(first + step) < word)
+                    {
+                    first += step + 1;
+                    count -= step + 1;
+                    }
+                else
+                    { count = step; }
+                }
+            return first;
+            }
+        [[nodiscard]] const char* GetRecord(const size_t index) const noexcept
+            { return m_records + index * COMPACTED_RECORD_LENGTH; }
+        [[nodiscard]] size_t GetRecordCount() const noexcept
+            { return m_recordCount; }
+        [[nodiscard]] size_t GetWordCount() const noexcept
+            { return m_wordCount; }
+    private:
+        uint32_t m_recordCount{ 0 };
+        uint32_t m_wordCount{ 0 };
+        const char* m_records{ nullptr };
+        const char* m_words{ nullptr };
+        const char* m_wordPool{ nullptr };
+        size_t m_wordPoolLength{ 0 };
+        const char* m_postings{ nullptr };
+        size_t m_postingCount{ 0 };
+        };
+    }
+
+std::vector<std::string> wxLogFileIndex::Tokenize(const std::string_view text)
+    {
+    std::vector<std::string> words;
+    size_t pos{ 0 };
+    while (pos < text.length())
+        {
+        while (pos < text.length() && !IsWordCharacter(static_cast<unsigned char>(text[pos])))
+            { ++pos; }
+        const size_t wordStart = pos;
+        while (pos < text.length() && IsWordCharacter(static_cast<unsigned char>(text[pos])))
+            { ++pos; }
+        if (pos == wordStart)
+            { break; }
+        std::string word(text.substr(wordStart, std::min(pos - wordStart, MAX_WORD_LENGTH)));
+        for (auto& ch : word)
+            {
+            if (ch >= 'A' && ch <= 'Z')
+                { ch = static_cast<char>(ch - 'A' + 'a'); }
+            }
+        words.push_back(std::move(word));
+        }
+    return words;
+    }
+
+bool wxLogFileIndex::Open(const wxString& filePath, const bool startOver /*= false*/)
+    {
+    Close();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_filePath = filePath;
+    if (!startOver && wxFileName::FileExists(filePath))
+        {
+        wxMappedFile indexFile(filePath);
+        if (LoadSegments(indexFile.GetData(), indexFile.GetLength()) &&
+            m_file.Open(filePath, wxFile::write_append))
+            { return true; }
+        // if the index is corrupt (e.g., the program crashed while it was being
+        // written), then it is started over
+        m_records.clear();
+        m_postings.clear();
+        }
+    if (!m_file.Create(filePath, true))
+        { return false; }
+    m_file.Write(INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    return true;
+    }
+
+void wxLogFileIndex::Close()
+    {
+    std::lock_guard<std::mutex> stringsLock(m_stringsMutex);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_file.Close();
+    m_records.clear();
+    m_postings.clear();
+    m_strings.clear();
+    }
+
+bool wxLogFileIndex::LoadSegments(const char* data, const size_t length)
+    {
+    if (length < sizeof(INDEX_MAGIC) || std::memcmp(data, INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0)
+        { return false; }
+    const char* pos = data + sizeof(INDEX_MAGIC);
+    const char* const end = data + length;
+
+    std::vector<RecordInfo> segmentRecords;
+    std::unordered_map<std::string, std::vector<uint32_t>> segmentPostings;
+    while (pos < end)
+        {
+        uint32_t recordCount{ 0 }, wordCount{ 0 };
+        if (!ReadValue(pos, end, recordCount))
+            { return false; }
+        segmentRecords.resize(recordCount);
+        for (auto& record : segmentRecords)
+            {
+            if (!ReadValue(pos, end, record.m_offset) || !ReadValue(pos, end, record.m_timestamp) ||
+                !ReadValue(pos, end, record.m_level))
+                { return false; }
+            }
+        if (!ReadValue(pos, end, wordCount))
+            { return false; }
+        segmentPostings.clear();
+        for (uint32_t i = 0; i < wordCount; ++i)
+            {
+            uint32_t wordLength{ 0 }, postingCount{ 0 };
+            if (!ReadValue(pos, end, wordLength) || static_cast<size_t>(end - pos) < wordLength)
+                { return false; }
+            auto& postings = segmentPostings[std::string(pos, wordLength)];
+            pos += wordLength;
+            if (!ReadValue(pos, end, postingCount))
+                { return false; }
+            postings.resize(postingCount);
+            for (auto& posting : postings)
+                {
+                if (!ReadValue(pos, end, posting) || posting >= recordCount)
+                    { return false; }
+                }
+            }
+        MergeSegment(segmentRecords, segmentPostings);
+        }
+    return true;
+    }
+
+void wxLogFileIndex::MergeSegment(const std::vector<RecordInfo>& segmentRecords,
+                                  const std::unordered_map<std::string, std::vector<uint32_t>>& segmentPostings)
+    {
+    const auto firstRecord = static_cast<uint32_t>(m_records.size());
+    m_records.insert(m_records.end(), segmentRecords.cbegin(), segmentRecords.cend());
+    for (const auto& [word, postings] : segmentPostings)
+        {
+        auto& allPostings = m_postings[word];
+        allPostings.reserve(allPostings.size() + postings.size());
+        for (const auto posting : postings)
+            { allPostings.push_back(firstRecord + posting); }
+        }
+    }
+
+void wxLogFileIndex::AddRecords(const std::string_view data,
+                                const std::vector<wxLogFileBatch::Record>& records,
+                                const uint64_t fileOffset, const bool binary)
+    {
+    // the records are tokenized before the index is locked, so searches can go on meanwhile
+    // (and the caller tokenizes them after unlocking the log file, so that writes can too)
+    std::lock_guard<std::mutex> stringsLock(m_stringsMutex);
+    if (binary)
+        {
+        // pick up the function and file names that the data defines
+        const char* pos = data.data();
+        const char* const end = pos + data.length();
+        if (wxLogFile::IsBinaryLog(pos, data.length()))
+            { pos += wxLogFile::GetBinaryLogHeaderLength(); }
+        while (pos < end && wxLogFile::DecodeBinaryRecord(pos, end, m_strings, nullptr))
+            {}
+        }
+    if (records.empty())
+        { return; }
+
+    std::vector<RecordInfo> segmentRecords;
+    segmentRecords.reserve(records.size());
+    std::unordered_map<std::string, std::vector<uint32_t>> segmentPostings;
+    wxString recordText;
+    for (size_t i = 0; i < records.size(); ++i)
+        {
+        const auto recordIndex = static_cast<uint32_t>(i);
+        segmentRecords.push_back({ fileOffset + records[i].m_offset,
+                                   static_cast<int64_t>(records[i].m_timestamp),
+                                   static_cast<uint32_t>(records[i].m_level) });
+        std::string_view recordData = data.substr(records[i].m_offset, records[i].m_length);
+        std::string renderedRecord;
+        if (binary)
+            {
+            const char* pos = recordData.data();
+            wxLogFile::DecodeBinaryRecord(pos, recordData.data() + recordData.length(),
+                                          m_strings, &recordText);
+            const auto recordUTF8 = recordText.utf8_str();
+            renderedRecord.assign(recordUTF8.data(), recordUTF8.length());
+            recordData = renderedRecord;
+            }
+        for (auto& word : Tokenize(recordData))
+            {
+            auto& postings = segmentPostings[std::move(word)];
+            // (a word can appear more than once in a record)
+            if (postings.empty() || postings.back() != recordIndex)
+                { postings.push_back(recordIndex); }
+            }
+        }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_file.IsOpened())
+        { return; }
+    // append the segment to the index file, so that it doesn't have to be rebuilt next time
+    std::string segment;
+    AppendValue(segment, static_cast<uint32_t>(segmentRecords.size()));
+    for (const auto& record : segmentRecords)
+        {
+        AppendValue(segment, record.m_offset);
+        AppendValue(segment, record.m_timestamp);
+        AppendValue(segment, record.m_level);
+        }
+    AppendValue(segment, static_cast<uint32_t>(segmentPostings.size()));
+    for (const auto& [word, postings] : segmentPostings)
+        {
+        AppendValue(segment, static_cast<uint32_t>(word.length()));
+        segment += word;
+        AppendValue(segment, static_cast<uint32_t>(postings.size()));
+        for (const auto posting : postings)
+            { AppendValue(segment, posting); }
+        }
+    m_file.Write(segment.data(), segment.length());
+
+    MergeSegment(segmentRecords, segmentPostings);
+    }
+
+std::vector<uint64_t> wxLogFileIndex::Find(const Query& query) const
+    {
+    const auto queryUTF8 = query.m_text.utf8_str();
+    const std::vector<std::string> words = Tokenize(std::string_view(queryUTF8.data(), queryUTF8.length()));
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<const std::vector<uint32_t>*> wordPostings;
+    for (const auto& word : words)
+        {
+        const auto postingsPos = m_postings.find(word);
+        if (postingsPos == m_postings.cend())
+            { return std::vector<uint64_t>{}; }
+        wordPostings.push_back(&postingsPos->second);
+        }
+
+    std::vector<uint64_t> offsets;
+    for (const auto candidate : IntersectPostings(wordPostings, m_records.size()))
+        {
+        if (MatchesFilters(query, m_records[candidate]))
+            { offsets.push_back(m_records[candidate].m_offset); }
+        }
+    return offsets;
+    }
+
+bool wxLogFileIndex::Compact(const wxString& indexPath, const wxString& compactedPath)
+    {
+    wxLogFileIndex index;
+        {
+        const wxMappedFile indexFile(indexPath);
+        if (!index.LoadSegments(indexFile.GetData(), indexFile.GetLength()))
+            { return false; }
+        }
+    // sort the words, so that searches can binary search them in the mapped file
+    std::vector<std::pair<std::string_view, const std::vector<uint32_t>*>> words;
+    words.reserve(index.m_postings.size());
+    uint64_t wordPoolLength{ 0 };
+    for (const auto& [word, postings] : index.m_postings)
+        {
+        words.push_back({ word, &postings });
+        wordPoolLength += word.length();
+        }
+    std::sort(words.begin(), words.end(),
+        [](const auto& first, const auto& second) noexcept
+        { return first.first < second.first; });
+
+    wxFile compactedFile;
+    if (!compactedFile.Create(compactedPath, true))
+        { return false; }
+    // written in chunks, as the postings of a large log don't need to be in memory twice
+    std::string buffer;
+    bool written{ true };
+    const auto writeBuffer = [&compactedFile, &buffer, &written](const size_t threshold)
+        {
+        if (buffer.length() >= threshold)
+            {
+            written = written && (compactedFile.Write(buffer.data(), buffer.length()) == buffer.length());
+            buffer.clear();
+            }
+        };
+    constexpr size_t CHUNK_LENGTH = 1024 * 1024;
+
+    buffer.append(COMPACTED_INDEX_MAGIC, sizeof(COMPACTED_INDEX_MAGIC));
+    AppendValue(buffer, static_cast<uint32_t>(index.m_records.size()));
+    AppendValue(buffer, static_cast<uint32_t>(words.size()));
+    AppendValue(buffer, wordPoolLength);
+    for (const auto& record : index.m_records)
+        {
+        AppendValue(buffer, record.m_offset);
+        AppendValue(buffer, record.m_timestamp);
+        AppendValue(buffer, record.m_level);
+        writeBuffer(CHUNK_LENGTH);
+        }
+    uint64_t wordOffset{ 0 }, firstPosting{ 0 };
+    for (const auto& [word, postings] : words)
+        {
+        AppendValue(buffer, wordOffset);
+        AppendValue(buffer, static_cast<uint32_t>(word.length()));
+        AppendValue(buffer, firstPosting);
+        AppendValue(buffer, static_cast<uint32_t>(postings->size()));
+        wordOffset += word.length();
+        firstPosting += postings->size();
+        writeBuffer(CHUNK_LENGTH);
+        }
+    for (const auto& word : words)
+        {
+        buffer += word.first;
+        writeBuffer(CHUNK_LENGTH);
+        }
+    for (const auto& word : words)
+        {
+        for (const auto posting : *word.second)
+            { AppendValue(buffer, posting); }
+        writeBuffer(CHUNK_LENGTH);
+        }
+    writeBuffer(0);
+    return compactedFile.Close() && written;
+    }
+
+std::vector<uint64_t> wxLogFileIndex::FindInFile(const wxString& compactedPath, const Query& query)
+    {
+    if (!wxFileName::FileExists(compactedPath))
+        { return std::vector<uint64_t>{}; }
+    const wxMappedFile indexFile(compactedPath);
+    CompactedIndexView index;
+    if (!index.Read(indexFile.GetData(), indexFile.GetLength()))
+        { return std::vector<uint64_t>{}; }
+
+    const auto queryUTF8 = query.m_text.utf8_str();
+    const std::vector<std::string> words = Tokenize(std::string_view(queryUTF8.data(), queryUTF8.length()));
+    // only the postings of the words being searched for are read out of the file
+    std::vector<std::vector<uint32_t>> postings(words.size());
+    std::vector<const std::vector<uint32_t>*> wordPostings;
+    for (size_t i = 0; i < words.size(); ++i)
+        {
+        const size_t wordIndex = index.LowerBound(words[i]);
+        if (wordIndex == index.GetWordCount() || index.GetWord(wordIndex) != words[i] ||
+            !index.GetPostings(wordIndex, postings[i]))
+            { return std::vector<uint64_t>{}; }
+        wordPostings.push_back(&postings[i]);
+        }
+
+    std::vector<uint64_t> offsets;
+    for (const auto candidate : IntersectPostings(wordPostings, index.GetRecordCount()))
+        {
+        const char* pos = index.GetRecord(candidate);
+        const char* const end = pos + COMPACTED_RECORD_LENGTH;
+        RecordInfo record;
+        if (ReadValue(pos, end, record.m_offset) && ReadValue(pos, end, record.m_timestamp) &&
+            ReadValue(pos, end, record.m_level) && MatchesFilters(query, record))
+            { offsets.push_back(record.m_offset); }
+        }
+    return offsets;
+    }
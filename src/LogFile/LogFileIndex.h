@@ -0,0 +1,169 @@
+/** @addtogroup wxCode
+    @brief A collection of wxWidget tools.
+    @date 2005-2021
+    @copyright Oleander Software, Ltd.
+    @author Blake Madden
+    @details This program is free software; you can redistribute it and/or modify
+    it under the terms of the BSD License.
+* @{*/
+
+#ifndef __WXLOGFILE_INDEX_H__
+#define __WXLOGFILE_INDEX_H__
+
+#include <wx/wx.h>
+#include <wx/string.h>
+#include <wx/log.h>
+#include <wx/file.h>
+#include <wx/filename.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <iterator>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "MappedFile.h"
+#include "LogFileSink.h"
+
+/** @brief An inverted index of the words in a log file's records, for searching it quickly.
+
+    Each word (i.e., run of letters, digits and underscores, compared case insensitively)
+    maps to the records that contain it. The index is kept in memory and appended to an
+    index file as records are added, so it can be loaded again later without rereading the log.
+
+    Once a log file is finished (e.g., rotated), Compact() rewrites its index file with the
+    words sorted, and FindInFile() searches that by mapping it, so finished logs are never
+    loaded into memory.
+
+    wxLogFile maintains one of these for its log file if wxLogFile::EnableSearchIndex() is called.
+    The record offsets that searches return can be passed to wxLogFileReader::GetRecordIndex().
+
+    @par Example:
+    @code
+    wxLogFileIndex::Query query;
+    query.m_text = L"connection timeout";
+    query.m_leastSevereLevel = wxLOG_Warning;
+    query.m_startTime = wxDateTime::Now().Subtract(wxTimeSpan::Hour()).GetTicks();
+
+    logFile->FlushAndWait();
+    wxLogFileReader reader(logFile->GetLogFilePath());
+    for (const auto offset : logFile->Search(query))
+        { wxPrintf(L"%s\n", reader.GetRecord(reader.GetRecordIndex(offset))); }
+    @endcode*/
+class wxLogFileIndex
+    {
+public:
+    /// @brief What to search for.
+    struct Query
+        {
+        /// The text to search for. Records have to contain every word in it.
+        wxString m_text;
+        /// The least severe level to include (e.g., @c wxLOG_Warning for errors and warnings).
+        wxLogLevel m_leastSevereLevel{ wxLOG_Max };
+        /// The earliest time that records were logged at.
+        time_t m_startTime{ std::numeric_limits<time_t>::min() };
+        /// The latest time that records were logged at.
+        time_t m_endTime{ std::numeric_limits<time_t>::max() };
+        };
+    /// @brief A record that matched a search of a log file and its rotated generations.
+    struct Match
+        {
+        /// The generation of the log file that the record is in
+        /// (see wxLogFile::GetRotatedLogFilePath()), or @c 0 for the current log file.
+        size_t m_generation{ 0 };
+        /// Where the record is in the (uncompressed) log file.
+        uint64_t m_offset{ 0 };
+        };
+
+    wxLogFileIndex() = default;
+
+    /** @brief Loads an index file, or starts a new one if it doesn't exist.
+        @param filePath The index file.
+        @param startOver @c true to clear the index file instead of loading it.
+        @returns @c true if the index file was opened.*/
+    bool Open(const wxString& filePath, const bool startOver = false);
+    /// @brief Closes the index file and empties the index.
+    void Close();
+    /// @returns The path of the index file.
+    [[nodiscard]] const wxString& GetFilePath() const noexcept
+        { return m_filePath; }
+
+    /** @brief Adds records that were written to the log file.
+        @param data The encoded records, as they were written to the log file.
+        @param records Where the records are in @c data.
+        @param fileOffset Where @c data starts in the log file.
+        @param binary @c true if the records are in wxLogFile's binary format.*/
+    void AddRecords(const std::string_view data, const std::vector<wxLogFileBatch::Record>& records,
+                    const uint64_t fileOffset, const bool binary);
+
+    /// @returns The offsets (in the log file) of the records that match a query, in file order.
+    /// @param query What to search for.
+    [[nodiscard]] std::vector<uint64_t> Find(const Query& query) const;
+    /// @returns The number of records in the index.
+    [[nodiscard]] size_t GetRecordCount() const
+        {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_records.size();
+        }
+
+    /** @brief Rewrites an index file with its words sorted, so that it can be searched
+            with FindInFile() without loading it.
+        @param indexPath The index file (as written by AddRecords()).
+        @param compactedPath Where to write the compacted index.
+        @returns @c true if the compacted index was written.*/
+    static bool Compact(const wxString& indexPath, const wxString& compactedPath);
+    /// @returns The offsets of the records in a compacted index that match a query, in file order.
+    /// @param compactedPath The compacted index file (see Compact()).
+    /// @param query What to search for.
+    [[nodiscard]] static std::vector<uint64_t> FindInFile(const wxString& compactedPath, const Query& query);
+
+    /// @returns The words in some UTF-8 text, folded to lowercase.
+    /// @param text The text to split.
+    [[nodiscard]] static std::vector<std::string> Tokenize(const std::string_view text);
+private:
+    /// A record in the log file.
+    struct RecordInfo
+        {
+        uint64_t m_offset{ 0 };
+        int64_t m_timestamp{ 0 };
+        uint32_t m_level{ 0 };
+        };
+    /// @returns @c true if a record passes a query's level and time filters.
+    [[nodiscard]] static bool MatchesFilters(const Query& query, const RecordInfo& record) noexcept
+        {
+        // (more severe levels have lower values)
+        return record.m_level <= static_cast<uint32_t>(query.m_leastSevereLevel) &&
+               record.m_timestamp >= static_cast<int64_t>(query.m_startTime) &&
+               record.m_timestamp <= static_cast<int64_t>(query.m_endTime);
+        }
+    /** @brief Adds a segment's records and words to the in-memory index.
+        @param segmentRecords The segment's records.
+        @param segmentPostings Each word in the segment and the (segment-relative)
+            records that it is in.*/
+    void MergeSegment(const std::vector<RecordInfo>& segmentRecords,
+                      const std::unordered_map<std::string, std::vector<uint32_t>>& segmentPostings);
+    /// Loads the segments in the index file.
+    /// @returns @c false if the file isn't a valid index.
+    bool LoadSegments(const char* data, const size_t length);
+
+    wxString m_filePath;
+    wxFile m_file;
+    std::vector<RecordInfo> m_records;
+    // each word, and the indices of the records that contain it (in ascending order)
+    std::unordered_map<std::string, std::vector<uint32_t>> m_postings;
+    mutable std::mutex m_mutex;
+    // function and file names in binary records
+    // (AddRecords() tokenizes records under this lock, so searches aren't held up by it)
+    std::unordered_map<uint32_t, wxString> m_strings;
+    std::mutex m_stringsMutex;
+
+    wxDECLARE_NO_COPY_CLASS(wxLogFileIndex);
+    };
+
+/** @}*/
+
+#endif //__WXLOGFILE_INDEX_H__
@@ -0,0 +1,168 @@
+/* copyright (c) Oleander Software, Ltd.
+   author: Blake Madden
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the BSD License.
+*/
+
+#include "LogFileReader.h"
+
+bool wxLogFileReader::Open(const wxString& filePath)
+    {
+    m_filePath = filePath;
+    m_recordOffsets.clear();
+    m_strings.clear();
+    if (!m_file.Map(filePath))
+        { return false; }
+    m_binary = wxLogFile::IsBinaryLog(m_file.GetData(), m_file.GetLength());
+    IndexRecords();
+    return true;
+    }
+
+size_t wxLogFileReader::Refresh()
+    {
+    const size_t previousCount = GetRecordCount();
+    const size_t indexedLength = m_recordOffsets.empty() ? 0 : m_recordOffsets.back();
+    const uint64_t previousFileId = m_file.GetFileId();
+    // the file is looked up before anything is read from the old mapping,
+    // which faults if the file was truncated
+    const bool fileChanged = HasFileChanged();
+    // (in case the file's ID isn't known, the start of the file is compared too)
+    const std::string previousStart = (fileChanged || previousFileId != 0) ? std::string{} :
+        std::string(m_file.GetData(), std::min({ indexedLength, m_file.GetLength(), FILE_START_LENGTH }));
+    if (!m_file.Map(m_filePath))
+        {
+        m_recordOffsets.clear();
+        m_strings.clear();
+        return 0;
+        }
+    // the file was started over (e.g., it was rotated, or deleted and created again),
+    // so index it from the beginning
+    if (fileChanged || m_file.GetLength() < indexedLength || m_recordOffsets.empty() ||
+        (previousFileId != 0 && m_file.GetFileId() != previousFileId) ||
+        (!previousStart.empty() &&
+         std::memcmp(m_file.GetData(), previousStart.data(), previousStart.length()) != 0))
+        {
+        m_recordOffsets.clear();
+        m_strings.clear();
+        m_binary = wxLogFile::IsBinaryLog(m_file.GetData(), m_file.GetLength());
+        IndexRecords();
+        return GetRecordCount();
+        }
+    IndexRecords();
+    return GetRecordCount() - previousCount;
+    }
+
+bool wxLogFileReader::HasFileChanged() const
+    {
+    uint64_t fileId{ 0 }, fileLength{ 0 };
+    if (!wxMappedFile::GetFileInfo(m_filePath, fileId, fileLength))
+        { return false; }
+    return fileLength < m_file.GetLength() ||
+        (m_file.GetFileId() != 0 && fileId != m_file.GetFileId());
+    }
+
+void wxLogFileReader::IndexRecords()
+    {
+    const char* const data = m_file.GetData();
+    const size_t length = m_file.GetLength();
+    size_t pos{ 0 };
+    if (m_recordOffsets.empty())
+        { pos = m_binary ? wxLogFile::GetBinaryLogHeaderLength() : 0; }
+    // pick up where the last indexing left off (and drop the end marker)
+    else
+        {
+        pos = m_recordOffsets.back();
+        m_recordOffsets.pop_back();
+        }
+
+    if (m_binary)
+        {
+        const char* current = data + pos;
+        const char* const end = data + length;
+        while (current < end)
+            {
+            const char* const recordStart = current;
+            bool isDefinition{ false };
+            // a partially written record will be picked up by the next refresh
+            if (!wxLogFile::DecodeBinaryRecord(current, end, m_strings, nullptr, &isDefinition))
+                {
+                current = recordStart;
+                break;
+                }
+            if (!isDefinition)
+                { m_recordOffsets.push_back(static_cast<size_t>(recordStart - data)); }
+            }
+        pos = static_cast<size_t>(current - data);
+        }
+    else
+        {
+        // each record ends with a bare LF (line breaks within a record are CRLF)
+        size_t searchPos = pos;
+        while (searchPos < length)
+            {
+            const void* newLine = std::memchr(data + searchPos, '\n', length - searchPos);
+            // a partially written record will be picked up by the next refresh
+            if (newLine == nullptr)
+                { break; }
+            const size_t newLinePos = static_cast<size_t>(static_cast<const char*>(newLine) - data);
+            searchPos = newLinePos + 1;
+            if (newLinePos > pos && data[newLinePos - 1] == '\r')
+                { continue; }
+            m_recordOffsets.push_back(pos);
+            pos = searchPos;
+            }
+        }
+    m_recordOffsets.push_back(pos);
+    }
+
+wxString wxLogFileReader::GetRecord(const size_t index) const
+    {
+    if (index >= GetRecordCount())
+        { return wxEmptyString; }
+    const char* const data = m_file.GetData();
+    if (m_binary)
+        {
+        const char* pos = data + m_recordOffsets[index];
+        wxString record;
+        wxLogFile::DecodeBinaryRecord(pos, data + m_file.GetLength(), m_strings, &record);
+        if (record.length() && record.Last() == L'\n')
+            { record.Truncate(record.length() - 1); }
+        return record;
+        }
+
+    const std::string_view record = GetRecordUTF8(index);
+    return wxString::FromUTF8(record.data(), record.length());
+    }
+
+std::string_view wxLogFileReader::GetRecordUTF8(const size_t index) const
+    {
+    if (index >= GetRecordCount())
+        { return std::string_view{}; }
+    if (m_binary)
+        {
+        const wxString record = GetRecord(index);
+        const auto recordUTF8 = record.utf8_str();
+        m_renderedRecord.assign(recordUTF8.data(), recordUTF8.length());
+        return m_renderedRecord;
+        }
+
+    const char* const data = m_file.GetData();
+    const size_t recordStart = m_recordOffsets[index];
+    size_t recordEnd = m_recordOffsets[index + 1];
+    while (recordEnd > recordStart && (data[recordEnd - 1] == '\n' || data[recordEnd - 1] == '\r'))
+        { --recordEnd; }
+    return std::string_view(data + recordStart, recordEnd - recordStart);
+    }
+
+std::vector<wxString> wxLogFileReader::GetRecords(const size_t first, const size_t count) const
+    {
+    std::vector<wxString> records;
+    const size_t recordCount = GetRecordCount();
+    if (first >= recordCount)
+        { return records; }
+    const size_t last = first + std::min(count, recordCount - first);
+    records.reserve(last - first);
+    for (size_t i = first; i < last; ++i)
+        { records.push_back(GetRecord(i)); }
+    return records;
+    }
@@ -0,0 +1,190 @@
+/** @addtogroup wxCode
+    @brief A collection of wxWidget tools.
+    @date 2005-2021
+    @copyright Oleander Software, Ltd.
+    @author Blake Madden
+    @details This program is free software; you can redistribute it and/or modify
+    it under the terms of the BSD License.
+* @{*/
+
+#ifndef __WXLOGFILE_READER_H__
+#define __WXLOGFILE_READER_H__
+
+#include <wx/wx.h>
+#include <wx/string.h>
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "LogFile.h"
+#include "MappedFile.h"
+
+/** @brief Reads the records from a log file written by wxLogFile, a page at a time.
+
+    Unlike wxLogFile::ReadLog(), this doesn't load and convert the whole file at once.
+    The file is memory mapped (where possible) and an index of where each record starts
+    is built when the file is opened. Records are only converted to text when they are asked for,
+    so it is cheap to show a page of records (or the last few) from a very large log.
+
+    Both text and binary (see wxLogFile::SetRecordFormat()) logs are supported.
+
+    @par Example:
+    @code
+    // make sure that everything logged so far is in the file
+    logFile->FlushAndWait();
+
+    wxLogFileReader reader(logFile->GetLogFilePath());
+    // the last 100 records
+    const std::vector<wxString> lastRecords = reader.GetTail(100);
+    // or the second page of 50 records
+    const std::vector<wxString> page = reader.GetRecords(50, 50);
+    // or all of them, one at a time
+    for (const wxString& record : reader)
+        { ... }
+    @endcode*/
+class wxLogFileReader
+    {
+public:
+    /// @brief Iterates through the records, formatting each one as it is read.
+    class const_iterator
+        {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = wxString;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const wxString*;
+        using reference = wxString;
+
+        /// Constructor.
+        /// @param reader The reader being iterated.
+        /// @param index The index of the record that the iterator starts at.
+        const_iterator(const wxLogFileReader* reader, const size_t index) noexcept :
+            m_reader(reader), m_index(index)
+            {}
+        /// @returns The current record.
+        [[nodiscard]] wxString operator*() const
+            { return m_reader->GetRecord(m_index); }
+        /// Moves to the next record.
+        const_iterator& operator++() noexcept
+            {
+            ++m_index;
+            return *this;
+            }
+        /// Moves to the next record.
+        const_iterator operator++(int) noexcept
+            {
+            const_iterator previous(*this);
+            ++m_index;
+            return previous;
+            }
+        [[nodiscard]] bool operator==(const const_iterator& that) const noexcept
+            { return m_reader == that.m_reader && m_index == that.m_index; }
+        [[nodiscard]] bool operator!=(const const_iterator& that) const noexcept
+            { return !(*this == that); }
+    private:
+        const wxLogFileReader* m_reader{ nullptr };
+        size_t m_index{ 0 };
+        };
+
+    wxLogFileReader() = default;
+    /// Constructor, which opens and indexes a log file.
+    /// @param filePath The log file to read.
+    explicit wxLogFileReader(const wxString& filePath)
+        { Open(filePath); }
+
+    /** @brief Opens a log file and indexes where its records start.
+        @param filePath The log file to read.
+        @returns @c true if the file was opened.*/
+    bool Open(const wxString& filePath);
+    /** @brief Picks up any records that were written to the file since it was opened
+            (or last refreshed).
+        @details Only the newly written part of the file is indexed. If the path refers to a
+            different file now, or the file got smaller or its start changed (e.g., it was rotated),
+            then it is indexed from the start again.
+        @returns The number of new records.*/
+    size_t Refresh();
+    /** @returns @c true if the file at the path was truncated or replaced since it was mapped,
+            so it should be refreshed before reading any more records.
+        @details Reading a record that was past the end of a truncated file faults,
+            so anything that reads records from a file that may be rewritten
+            (rather than just appended to) should check this first.\n
+            This looks the file up (a @c stat() call), so check it once before reading a page of
+            records, rather than before each record.
+        @note A file that was deleted (or is being rotated) is still readable through the
+            old mapping, so that isn't reported as a change.*/
+    [[nodiscard]] bool HasFileChanged() const;
+
+    /// @returns The path of the file being read.
+    [[nodiscard]] const wxString& GetFilePath() const noexcept
+        { return m_filePath; }
+    /// @returns @c true if the file is a binary log.
+    [[nodiscard]] bool IsBinary() const noexcept
+        { return m_binary; }
+    /// @returns The number of records in the file.
+    [[nodiscard]] size_t GetRecordCount() const noexcept
+        { return m_recordOffsets.empty() ? 0 : m_recordOffsets.size() - 1; }
+
+    /// @returns The index of the record that starts at an offset in the file
+    ///     (e.g., from wxLogFile::Search()), or GetRecordCount() if no record starts there.
+    /// @param offset The position of the record in the file.
+    [[nodiscard]] size_t GetRecordIndex(const size_t offset) const noexcept
+        {
+        const size_t recordCount = GetRecordCount();
+        const auto recordPos = std::lower_bound(m_recordOffsets.cbegin(),
+                                                m_recordOffsets.cbegin() + recordCount, offset);
+        return (recordPos != m_recordOffsets.cbegin() + recordCount && *recordPos == offset) ?
+            static_cast<size_t>(recordPos - m_recordOffsets.cbegin()) : recordCount;
+        }
+
+    /// @returns The given record, formatted as text (without its trailing newline).
+    /// @param index The index of the record.
+    [[nodiscard]] wxString GetRecord(const size_t index) const;
+    /** @returns The given record as UTF-8 text (without its trailing newline).
+        @details For a text log, this is a view of the record in the file, so nothing
+            is converted or copied. A binary record has to be rendered first, so the view
+            is only valid until the next call.
+        @param index The index of the record.*/
+    [[nodiscard]] std::string_view GetRecordUTF8(const size_t index) const;
+    /** @returns A range of records.
+        @param first The index of the first record.
+        @param count The (maximum) number of records to return.*/
+    [[nodiscard]] std::vector<wxString> GetRecords(const size_t first, const size_t count) const;
+    /// @returns The last records in the file.
+    /// @param count The (maximum) number of records to return.
+    [[nodiscard]] std::vector<wxString> GetTail(const size_t count) const
+        {
+        const size_t recordCount = GetRecordCount();
+        return GetRecords(recordCount - std::min(count, recordCount), count);
+        }
+
+    /// @returns An iterator to the first record.
+    [[nodiscard]] const_iterator begin() const noexcept
+        { return const_iterator(this, 0); }
+    /// @returns An iterator past the last record.
+    [[nodiscard]] const_iterator end() const noexcept
+        { return const_iterator(this, GetRecordCount()); }
+private:
+    /// Indexes the records after the part of the file that was already indexed.
+    void IndexRecords();
+
+    // how much of the start of the file Refresh() compares to tell whether it was replaced
+    static constexpr size_t FILE_START_LENGTH{ 256 };
+
+    wxString m_filePath;
+    wxMappedFile m_file;
+    bool m_binary{ false };
+    // where each record starts, followed by where the last indexed record ends
+    std::vector<size_t> m_recordOffsets;
+    // function and file names in a binary log
+    mutable wxLogFile::BinaryLogStrings m_strings;
+    // the last binary record rendered by GetRecordUTF8()
+    mutable std::string m_renderedRecord;
+
+    wxDECLARE_NO_COPY_CLASS(wxLogFileReader);
+    };
+
+/** @}*/
+
+#endif //__WXLOGFILE_READER_H__
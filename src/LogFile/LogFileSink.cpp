@@ -0,0 +1,162 @@
+/* copyright (c) Oleander Software, Ltd.
+   author: Blake Madden
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the BSD License.
+*/
+
+#include "LogFileSink.h"
+#include "LogFile.h"
+
+void wxLogFileMemorySink::Write(const std::shared_ptr<const wxLogFileBatch>& batch)
+    {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (batch->m_binary)
+        {
+        // pick up the function and file names that the batch defines
+        const char* pos = batch->m_data.data();
+        const char* const end = pos + batch->m_data.length();
+        if (wxLogFile::IsBinaryLog(pos, batch->m_data.length()))
+            { pos += wxLogFile::GetBinaryLogHeaderLength(); }
+        while (pos < end && wxLogFile::DecodeBinaryRecord(pos, end, m_strings, nullptr))
+            {}
+        }
+    for (size_t i = 0; i < batch->m_records.size(); ++i)
+        { m_records.push_back({ batch, i }); }
+    m_receivedRecords += batch->m_records.size();
+    // a batch is released once none of its records are kept
+    while (m_records.size() > m_maxRecords)
+        { m_records.pop_front(); }
+    }
+
+wxString wxLogFileMemorySink::FormatRecord(const RecordReference& record) const
+    {
+    const std::string_view data = record.m_batch->GetRecordData(record.m_index);
+    wxString text;
+    if (record.m_batch->m_binary)
+        {
+        const char* pos = data.data();
+        wxLogFile::DecodeBinaryRecord(pos, data.data() + data.length(), m_strings, &text);
+        }
+    else
+        { text = wxString::FromUTF8(data.data(), data.length()); }
+    if (text.length() && text.Last() == L'\n')
+        { text.Truncate(text.length() - 1); }
+    return text;
+    }
+
+wxString wxLogFileMemorySink::GetRecord(const size_t index) const
+    {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return (index < m_records.size()) ? FormatRecord(m_records[index]) : wxString{};
+    }
+
+std::vector<wxString> wxLogFileMemorySink::GetTail(const size_t count) const
+    {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<wxString> records;
+    const size_t first = m_records.size() - std::min(count, m_records.size());
+    records.reserve(m_records.size() - first);
+    for (size_t i = first; i < m_records.size(); ++i)
+        { records.push_back(FormatRecord(m_records[i])); }
+    return records;
+    }
+
+void wxLogFileMemorySink::Clear()
+    {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_records.clear();
+    }
+
+wxLogFileArchiveSink::wxLogFileArchiveSink(const wxString& filePath, const size_t compressBytes,
+                                           const long compressIntervalSeconds) :
+    m_compressBytes(compressBytes),
+    m_compressInterval(std::chrono::seconds(std::max(compressIntervalSeconds, 0L)))
+    {
+    m_fileStream = std::make_unique<wxFileOutputStream>(filePath);
+    if (m_fileStream->IsOk())
+        {
+        m_compressedStream = std::make_unique<wxZlibOutputStream>(*m_fileStream, wxZ_DEFAULT_COMPRESSION,
+                                                                  wxZLIB_GZIP);
+        m_compressionThread = std::thread(&wxLogFileArchiveSink::CompressionThreadMain, this);
+        }
+    }
+
+wxLogFileArchiveSink::~wxLogFileArchiveSink()
+    {
+    if (m_compressionThread.joinable())
+        {
+            {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+            }
+        m_batchesHeld.notify_one();
+        m_compressionThread.join();
+        }
+    std::unique_lock<std::mutex> lock(m_mutex);
+    CompressPendingBatches(lock);
+    if (m_compressedStream)
+        { m_compressedStream->Close(); }
+    }
+
+void wxLogFileArchiveSink::Write(const std::shared_ptr<const wxLogFileBatch>& batch)
+    {
+    bool compressionDue{ false };
+        {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pendingBatches.push_back(batch);
+        m_pendingBytes += batch->m_data.length();
+        compressionDue = (m_pendingBytes >= m_compressBytes || m_compressInterval.count() == 0);
+        }
+    // (otherwise, the thread wakes up on its own when the interval passes)
+    if (compressionDue)
+        { m_batchesHeld.notify_one(); }
+    }
+
+void wxLogFileArchiveSink::Flush()
+    {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    CompressPendingBatches(lock);
+    lock.unlock();
+    std::lock_guard<std::mutex> streamLock(m_streamMutex);
+    if (m_compressedStream)
+        { m_compressedStream->Sync(); }
+    }
+
+void wxLogFileArchiveSink::CompressionThreadMain()
+    {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    const auto isDue = [this]()
+        {
+        return m_stopping || (!m_pendingBatches.empty() &&
+            (m_pendingBytes >= m_compressBytes || m_compressInterval.count() == 0));
+        };
+    for (;;)
+        {
+        if (m_compressInterval.count() > 0)
+            { m_batchesHeld.wait_until(lock, m_lastCompression + m_compressInterval, isDue); }
+        else
+            { m_batchesHeld.wait(lock, isDue); }
+        // (the destructor compresses whatever is left)
+        if (m_stopping)
+            { break; }
+        CompressPendingBatches(lock);
+        }
+    }
+
+void wxLogFileArchiveSink::CompressPendingBatches(std::unique_lock<std::mutex>& lock)
+    {
+    std::vector<std::shared_ptr<const wxLogFileBatch>> batches;
+    batches.swap(m_pendingBatches);
+    m_pendingBytes = 0;
+    m_lastCompression = std::chrono::steady_clock::now();
+        {
+        std::lock_guard<std::mutex> streamLock(m_streamMutex);
+        lock.unlock();
+        if (m_compressedStream)
+            {
+            for (const auto& batch : batches)
+                { m_compressedStream->Write(batch->m_data.data(), batch->m_data.length()); }
+            }
+        }
+    lock.lock();
+    }
@@ -0,0 +1,191 @@
+/** @addtogroup wxCode
+    @brief A collection of wxWidget tools.
+    @date 2005-2021
+    @copyright Oleander Software, Ltd.
+    @author Blake Madden
+    @details This program is free software; you can redistribute it and/or modify
+    it under the terms of the BSD License.
+* @{*/
+
+#ifndef __WXLOGFILE_SINK_H__
+#define __WXLOGFILE_SINK_H__
+
+#include <wx/wx.h>
+#include <wx/string.h>
+#include <wx/log.h>
+#include <wx/wfstream.h>
+#include <wx/zstream.h>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <ctime>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/** @brief A batch of records merged by wxLogFile::Flush(), shared by all of its sinks.
+    @details The records are already encoded (i.e., formatted as UTF-8 text, or in the
+        binary format), so they are only formatted once no matter how many sinks there are.*/
+struct wxLogFileBatch
+    {
+    /// Where a record is in the batch, and what it was logged with.
+    struct Record
+        {
+        size_t m_offset{ 0 };
+        size_t m_length{ 0 };
+        wxLogLevel m_level{ wxLOG_Message };
+        time_t m_timestamp{ 0 };
+        };
+
+    /// @returns The encoded bytes of a record.
+    /// @param index The index of the record.
+    [[nodiscard]] std::string_view GetRecordData(const size_t index) const
+        {
+        return std::string_view(m_data).substr(m_records[index].m_offset,
+                                               m_records[index].m_length);
+        }
+
+    /// The encoded records. For binary records, this also includes the definitions
+    /// of any function and file names that the records are the first to refer to.
+    std::string m_data;
+    /// The records in @c m_data.
+    std::vector<Record> m_records;
+    /// @c true if the records are in wxLogFile's binary format.
+    bool m_binary{ false };
+    };
+
+/** @brief A destination for a wxLogFile's records, in addition to its log file.
+    @details Sinks are added with wxLogFile::AddSink(). Each merged batch of records is
+        passed to every sink's Write(), which should return quickly (e.g., by holding on
+        to the batch and processing it later). Otherwise, the sink is free to decide
+        when it does the actual work.*/
+class wxLogFileSink
+    {
+public:
+    virtual ~wxLogFileSink() = default;
+    /** @brief Receives a batch of records.
+        @details This is called from whichever thread is flushing the logger, with
+            batches in the order that they were logged.
+            When a sink is added to a logger with binary records, its first batch
+            holds the binary header and all function and file names defined so far,
+            but no records.
+        @param batch The records.*/
+    virtual void Write(const std::shared_ptr<const wxLogFileBatch>& batch) = 0;
+    /// @brief Finishes any work that the sink put off. Called when the sink is removed
+    ///     and when the logger is destroyed.
+    virtual void Flush() {}
+    };
+
+/** @brief Keeps the most recent records in memory, e.g., for a live log panel.
+    @details The batches are shared rather than copied, and records are only
+        converted to text when they are asked for.*/
+class wxLogFileMemorySink final : public wxLogFileSink
+    {
+public:
+    /// Constructor.
+    /// @param maxRecords The most records to keep.
+    explicit wxLogFileMemorySink(const size_t maxRecords = 10000) :
+        m_maxRecords(std::max<size_t>(maxRecords, 1))
+        {}
+
+    void Write(const std::shared_ptr<const wxLogFileBatch>& batch) final;
+
+    /// @returns The number of records being kept.
+    [[nodiscard]] size_t GetRecordCount() const
+        {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_records.size();
+        }
+    /// @returns The number of records ever received (useful for noticing new ones).
+    [[nodiscard]] uint64_t GetReceivedRecordCount() const
+        {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_receivedRecords;
+        }
+    /// @returns A record, formatted as text (without its trailing newline).
+    /// @param index The index of the record (@c 0 being the oldest one kept).
+    [[nodiscard]] wxString GetRecord(const size_t index) const;
+    /// @returns The most recent records.
+    /// @param count The (maximum) number of records to return.
+    [[nodiscard]] std::vector<wxString> GetTail(const size_t count) const;
+    /// @brief Discards the kept records.
+    void Clear();
+private:
+    /// A record in one of the kept batches.
+    struct RecordReference
+        {
+        std::shared_ptr<const wxLogFileBatch> m_batch;
+        size_t m_index{ 0 };
+        };
+    /// @returns A record, formatted as text.
+    /// @note The mutex must be locked by the caller.
+    [[nodiscard]] wxString FormatRecord(const RecordReference& record) const;
+
+    size_t m_maxRecords{ 10000 };
+    std::deque<RecordReference> m_records;
+    uint64_t m_receivedRecords{ 0 };
+    // function and file names in binary records
+    mutable std::unordered_map<uint32_t, wxString> m_strings;
+    mutable std::mutex m_mutex;
+    };
+
+/** @brief Writes the records to a gzip-compressed archive.
+    @details Batches are held until enough of them have built up (or enough time
+        has passed), and are then compressed together on the sink's own thread,
+        so the thread flushing the logger never waits on the compression.
+    @note Add this before any records are logged (and after choosing the logger's
+        record format) to have a complete log in the archive.*/
+class wxLogFileArchiveSink final : public wxLogFileSink
+    {
+public:
+    /** @brief Constructor, which creates the archive file.
+        @param filePath The archive file to write (usually with a @c .gz extension).
+        @param compressBytes How many bytes of records to hold before compressing them.
+        @param compressIntervalSeconds The most seconds to hold records before compressing them.*/
+    explicit wxLogFileArchiveSink(const wxString& filePath, const size_t compressBytes = 1024 * 1024,
+                                  const long compressIntervalSeconds = 60);
+    /// Destructor, which compresses any records still being held, finishes the archive
+    /// and stops the sink's thread.
+    ~wxLogFileArchiveSink();
+
+    void Write(const std::shared_ptr<const wxLogFileBatch>& batch) final;
+    void Flush() final;
+
+    /// @returns @c true if the archive file was created.
+    [[nodiscard]] bool IsOk() const noexcept
+        { return m_compressedStream != nullptr; }
+private:
+    /** @brief Compresses the held batches.
+        @param lock The lock on the mutex, which is let go of while compressing
+            (so that more batches can be held in the meantime) and locked again after.*/
+    void CompressPendingBatches(std::unique_lock<std::mutex>& lock);
+    /// The sink's thread, which compresses the held batches when there are enough of them
+    /// or when the interval passes (whether or not anything else was written).
+    void CompressionThreadMain();
+
+    std::unique_ptr<wxFileOutputStream> m_fileStream;
+    std::unique_ptr<wxZlibOutputStream> m_compressedStream;
+    std::vector<std::shared_ptr<const wxLogFileBatch>> m_pendingBatches;
+    size_t m_pendingBytes{ 0 };
+    size_t m_compressBytes{ 1024 * 1024 };
+    std::chrono::steady_clock::duration m_compressInterval{ std::chrono::seconds(60) };
+    std::chrono::steady_clock::time_point m_lastCompression{ std::chrono::steady_clock::now() };
+    // guards the held batches
+    std::mutex m_mutex;
+    // guards the compressed stream (locked before the batches are let go of, so that
+    // they are compressed in the order that they were written)
+    std::mutex m_streamMutex;
+    std::condition_variable m_batchesHeld;
+    std::thread m_compressionThread;
+    bool m_stopping{ false };
+    };
+
+/** @}*/
+
+#endif //__WXLOGFILE_SINK_H__
@@ -0,0 +1,185 @@
+/* copyright (c) Oleander Software, Ltd.
+   author: Blake Madden
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the BSD License.
+*/
+
+#include "LogFileViewer.h"
+
+wxBEGIN_EVENT_TABLE(wxLogFileViewer, wxListCtrl)
+    EVT_TIMER(wxID_ANY, wxLogFileViewer::OnTailTimer)
+    EVT_IDLE(wxLogFileViewer::OnIdle)
+wxEND_EVENT_TABLE()
+
+wxLogFileViewer::wxLogFileViewer(wxWindow* parent, wxWindowID id /*= wxID_ANY*/,
+                                 const wxPoint& pos /*= wxDefaultPosition*/,
+                                 const wxSize& size /*= wxDefaultSize*/,
+                                 long style /*= wxLC_HRULES | wxLC_VRULES*/) :
+    wxListCtrl(parent, id, pos, size, style | wxLC_REPORT | wxLC_VIRTUAL),
+    m_tailTimer(this), m_remapTimer(this)
+    {
+    AppendColumn(_("Level"));
+    AppendColumn(_("Timestamp"), wxLIST_FORMAT_LEFT, FromDIP(140));
+    AppendColumn(_("Message"), wxLIST_FORMAT_LEFT, FromDIP(400));
+    AppendColumn(_("Function"), wxLIST_FORMAT_LEFT, FromDIP(150));
+    AppendColumn(_("File"), wxLIST_FORMAT_LEFT, FromDIP(120));
+    AppendColumn(_("Line"), wxLIST_FORMAT_RIGHT);
+
+    m_errorAttr.SetTextColour(*wxRED);
+    m_warningAttr.SetTextColour(wxColour(L"#B8860B"));
+    m_debugAttr.SetTextColour(wxSystemSettings::GetColour(wxSYS_COLOUR_GRAYTEXT));
+    }
+
+bool wxLogFileViewer::Open(const wxString& filePath)
+    {
+    const bool opened = m_reader.Open(filePath);
+    m_cachedItem = -1;
+    m_fileChangeChecked = false;
+    SetItemCount(static_cast<long>(m_reader.GetRecordCount()));
+    Refresh();
+    return opened;
+    }
+
+size_t wxLogFileViewer::RefreshRecords()
+    {
+    const long previousCount = GetItemCount();
+    // if the last record was in view, then keep it in view
+    const bool showingLast = (previousCount == 0 ||
+                              GetTopItem() + GetCountPerPage() >= previousCount);
+    const size_t newRecords = m_reader.Refresh();
+    m_fileChangeChecked = false;
+    const auto recordCount = static_cast<long>(m_reader.GetRecordCount());
+    // (the file may have been started over, even if there are no new records)
+    if (newRecords == 0 && recordCount == previousCount)
+        { return 0; }
+    m_cachedItem = -1;
+    SetItemCount(recordCount);
+    if (showingLast && recordCount > 0)
+        { EnsureVisible(recordCount - 1); }
+    Refresh();
+    return newRecords;
+    }
+
+void wxLogFileViewer::EnableTailFollow(const bool follow /*= true*/, const int intervalMilliseconds /*= 500*/)
+    {
+    if (follow)
+        { m_tailTimer.Start(std::max(intervalMilliseconds, 1)); }
+    else
+        { m_tailTimer.Stop(); }
+    }
+
+void wxLogFileViewer::OnTailTimer([[maybe_unused]] wxTimerEvent& event)
+    { RefreshRecords(); }
+
+void wxLogFileViewer::OnIdle(wxIdleEvent& event)
+    {
+    // the rows for a paint have all been asked for by now, so look the file up again for the next one
+    m_fileChangeChecked = false;
+    event.Skip();
+    }
+
+wxLogFileViewer::RecordFields wxLogFileViewer::SplitRecord(std::string_view record)
+    {
+    RecordFields fields;
+    const auto toString = [](const std::string_view text)
+        { return wxString::FromUTF8(text.data(), text.length()); };
+
+    // the level is the prefix in front of the message
+    constexpr std::pair<std::string_view, wxLogLevel> LEVEL_PREFIXES[] =
+        {
+        { "Error: ", wxLOG_Error },
+        { "Warning: ", wxLOG_Warning },
+        { "Debug: ", wxLOG_Debug }
+        };
+    for (const auto& [prefix, level] : LEVEL_PREFIXES)
+        {
+        if (record.substr(0, prefix.length()) == prefix)
+            {
+            fields.m_level = level;
+            record.remove_prefix(prefix.length());
+            break;
+            }
+        }
+    fields.m_columns[LevelColumn] = (fields.m_level == wxLOG_Error) ? _("Error") :
+                                    (fields.m_level == wxLOG_Warning) ? _("Warning") :
+                                    (fields.m_level == wxLOG_Debug) ? _("Debug") : _("Message");
+
+    // records with a call site end with "\ttimestamp\tfunction\tfile: line N"
+    // (split from the end, as the message itself may have tabs in it)
+    std::string_view callSite[3];
+    std::string_view remaining = record;
+    size_t field = 3;
+    while (field > 0)
+        {
+        const size_t tab = remaining.rfind('\t');
+        if (tab == std::string_view::npos)
+            { break; }
+        callSite[--field] = remaining.substr(tab + 1);
+        remaining = remaining.substr(0, tab);
+        }
+    constexpr std::string_view LINE_LABEL{ ": line " };
+    const size_t lineLabel = callSite[2].rfind(LINE_LABEL);
+    if (field > 0 || lineLabel == std::string_view::npos)
+        {
+        // just a message
+        fields.m_columns[MessageColumn] = toString(record);
+        return fields;
+        }
+    fields.m_columns[MessageColumn] = toString(remaining);
+    fields.m_columns[TimestampColumn] = toString(callSite[0]);
+    fields.m_columns[FunctionColumn] = toString(callSite[1]);
+    fields.m_columns[FileColumn] = toString(callSite[2].substr(0, lineLabel));
+    fields.m_columns[LineColumn] = toString(callSite[2].substr(lineLabel + LINE_LABEL.length()));
+    return fields;
+    }
+
+const wxLogFileViewer::RecordFields& wxLogFileViewer::GetRecordFields(const long item) const
+    {
+    if (item != m_cachedItem)
+        {
+        // if the file was truncated or replaced, then the row isn't read from the old mapping
+        // (which faults past the end of a truncated file); the file is remapped once the list
+        // is done asking for rows instead, and the rows are shown again then
+        // (the file is only looked up for the first row that the list asks for, not every one)
+        if (!m_fileChangeChecked)
+            {
+            m_fileChanged = m_reader.HasFileChanged();
+            m_fileChangeChecked = true;
+            }
+        if (m_fileChanged)
+            {
+            if (!m_remapTimer.IsRunning())
+                { m_remapTimer.StartOnce(1); }
+            m_cachedFields = RecordFields{};
+            m_cachedItem = -1;
+            return m_cachedFields;
+            }
+        m_cachedFields = SplitRecord(m_reader.GetRecordUTF8(static_cast<size_t>(item)));
+        m_cachedItem = item;
+        }
+    return m_cachedFields;
+    }
+
+wxString wxLogFileViewer::OnGetItemText(long item, long column) const
+    {
+    if (item < 0 || column < 0 || column >= COLUMN_COUNT)
+        { return wxEmptyString; }
+    return GetRecordFields(item).m_columns[column];
+    }
+
+wxListItemAttr* wxLogFileViewer::OnGetItemAttr(long item) const
+    {
+    if (item < 0)
+        { return nullptr; }
+    switch (GetRecordFields(item).m_level)
+        {
+        case wxLOG_Error:
+            return &m_errorAttr;
+        case wxLOG_Warning:
+            return &m_warningAttr;
+        case wxLOG_Debug:
+            return &m_debugAttr;
+        default:
+            return nullptr;
+        }
+    }
@@ -0,0 +1,132 @@
+/** @addtogroup wxCode
+    @brief A collection of wxWidget tools.
+    @date 2005-2021
+    @copyright Oleander Software, Ltd.
+    @author Blake Madden
+    @details This program is free software; you can redistribute it and/or modify
+    it under the terms of the BSD License.
+* @{*/
+
+#ifndef __WXLOGFILE_VIEWER_H__
+#define __WXLOGFILE_VIEWER_H__
+
+#include <wx/wx.h>
+#include <wx/string.h>
+#include <wx/listctrl.h>
+#include <wx/timer.h>
+#include <array>
+#include <string_view>
+#include "LogFileReader.h"
+
+/** @brief A list control that shows the records in a log file written by wxLogFile.
+
+    The list is virtual, so rows are only read (through wxLogFileReader) and split into
+    their level, timestamp, message, function, file and line columns as they are scrolled
+    into view. Opening a very large log only indexes where its records start, and memory
+    use doesn't depend on how much of it has been looked at.
+
+    With tail-follow enabled, the file is checked periodically for records written by
+    later flushes. Only the new part of the file is indexed, and the list scrolls to the
+    newest record if it was showing the last one already.
+
+    Rows aren't read from the file if it was truncated or replaced (e.g., rotated) since it
+    was mapped; it is remapped first (whether or not tail-follow is enabled). The file is
+    looked up once for the rows shown by a paint, rather than once per row.
+
+    @par Example:
+    @code
+    auto viewer = new wxLogFileViewer(theParentDlg);
+    viewer->Open(logFile->GetLogFilePath());
+    viewer->EnableTailFollow();
+    @endcode*/
+class wxLogFileViewer final : public wxListCtrl
+    {
+public:
+    /// @brief The columns in the list.
+    enum Column
+        {
+        LevelColumn,
+        TimestampColumn,
+        MessageColumn,
+        FunctionColumn,
+        FileColumn,
+        LineColumn,
+        COLUMN_COUNT
+        };
+
+    /** Constructor.
+        @param parent The parent window.
+        @param id The ID for this control.
+        @param pos The position.
+        @param size The size of the control.
+        @param style The window style for this control. (@c wxLC_REPORT and
+            @c wxLC_VIRTUAL are always included.)*/
+    explicit wxLogFileViewer(wxWindow* parent, wxWindowID id = wxID_ANY,
+                             const wxPoint& pos = wxDefaultPosition,
+                             const wxSize& size = wxDefaultSize,
+                             long style = wxLC_HRULES | wxLC_VRULES);
+
+    /** @brief Shows a log file's records.
+        @param filePath The log file to show.
+        @returns @c true if the file was opened.*/
+    bool Open(const wxString& filePath);
+    /** @brief Shows any records that were written to the file since it was opened
+            (or last refreshed).
+        @returns The number of new records.*/
+    size_t RefreshRecords();
+    /// @returns The reader for the log file being shown.
+    [[nodiscard]] const wxLogFileReader& GetReader() const noexcept
+        { return m_reader; }
+
+    /** @brief Sets whether new records are picked up (and scrolled to) automatically.
+        @param follow @c true to check for new records.
+        @param intervalMilliseconds How often to check for new records.*/
+    void EnableTailFollow(const bool follow = true, const int intervalMilliseconds = 500);
+    /// @returns @c true if new records are being picked up automatically.
+    [[nodiscard]] bool IsFollowingTail() const
+        { return m_tailTimer.IsRunning(); }
+protected:
+    wxString OnGetItemText(long item, long column) const final;
+    wxListItemAttr* OnGetItemAttr(long item) const final;
+private:
+    /// A record, split into the text for each column.
+    struct RecordFields
+        {
+        std::array<wxString, COLUMN_COUNT> m_columns;
+        wxLogLevel m_level{ wxLOG_Message };
+        };
+    /// @returns A record, split into its fields.
+    /// @param record The record, in the layout that wxLogFile writes.
+    [[nodiscard]] static RecordFields SplitRecord(std::string_view record);
+    /// @returns The fields of a record (which are cached, as the list asks for them one column at a time).
+    /// @param item The index of the record.
+    [[nodiscard]] const RecordFields& GetRecordFields(const long item) const;
+
+    /// Picks up new records (for tail-follow) or remaps a file that changed.
+    void OnTailTimer(wxTimerEvent& event);
+    /// Has the file looked up again for the next rows that the list asks for.
+    void OnIdle(wxIdleEvent& event);
+
+    wxLogFileReader m_reader;
+    wxTimer m_tailTimer;
+    // started (while the list is asking for rows) when the file needs to be remapped
+    mutable wxTimer m_remapTimer;
+
+    mutable long m_cachedItem{ -1 };
+    // whether the file was truncated or replaced, as of the first row asked for since the list
+    // was last idle (looking the file up for every row would be a stat per row)
+    mutable bool m_fileChanged{ false };
+    mutable bool m_fileChangeChecked{ false };
+    mutable RecordFields m_cachedFields;
+
+    mutable wxListItemAttr m_errorAttr;
+    mutable wxListItemAttr m_warningAttr;
+    mutable wxListItemAttr m_debugAttr;
+
+    wxDECLARE_NO_COPY_CLASS(wxLogFileViewer);
+    wxDECLARE_EVENT_TABLE();
+    };
+
+/** @}*/
+
+#endif //__WXLOGFILE_VIEWER_H__
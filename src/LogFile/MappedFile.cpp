@@ -0,0 +1,215 @@
+/* copyright (c) Oleander Software, Ltd.
+   author: Blake Madden
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the BSD License.
+*/
+
+#include "MappedFile.h"
+#ifdef __WXMSW__
+    #include <wx/msw/wrapwin.h>
+#else
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+namespace
+    {
+    // combines a file's device (or volume) and its inode (or file index) into one ID
+    constexpr uint64_t MakeFileId(const uint64_t device, const uint64_t fileIndex) noexcept
+        { return (fileIndex ^ (device * 0x9E3779B97F4A7C15ULL)) | 1; }
+    }
+
+bool wxMappedFile::Map(const wxString& filePath)
+    {
+    Unmap();
+#ifdef __WXMSW__
+    HANDLE fileHandle = ::CreateFileW(filePath.wc_str(), GENERIC_READ,
+        FILE_SHARE_READ|FILE_SHARE_WRITE|FILE_SHARE_DELETE, nullptr,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (fileHandle != INVALID_HANDLE_VALUE)
+        {
+        BY_HANDLE_FILE_INFORMATION fileInfo{};
+        if (::GetFileInformationByHandle(fileHandle, &fileInfo))
+            {
+            m_fileId = MakeFileId(fileInfo.dwVolumeSerialNumber,
+                (static_cast<uint64_t>(fileInfo.nFileIndexHigh) << 32) | fileInfo.nFileIndexLow);
+            }
+        LARGE_INTEGER fileSize{};
+        if (::GetFileSizeEx(fileHandle, &fileSize) && fileSize.QuadPart > 0)
+            {
+            HANDLE mappingHandle = ::CreateFileMappingW(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (mappingHandle != nullptr)
+                {
+                const void* view = ::MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+                if (view != nullptr)
+                    {
+                    m_fileHandle = fileHandle;
+                    m_mappingHandle = mappingHandle;
+                    m_data = static_cast<const char*>(view);
+                    m_length = static_cast<size_t>(fileSize.QuadPart);
+                    m_mapped = true;
+                    return true;
+                    }
+                ::CloseHandle(mappingHandle);
+                }
+            }
+        ::CloseHandle(fileHandle);
+        }
+#else
+    const int fileDescriptor = ::open(filePath.fn_str(), O_RDONLY);
+    if (fileDescriptor != -1)
+        {
+        struct stat fileInfo{};
+        const bool hasFileInfo = (::fstat(fileDescriptor, &fileInfo) == 0);
+        if (hasFileInfo)
+            {
+            m_fileId = MakeFileId(static_cast<uint64_t>(fileInfo.st_dev),
+                                  static_cast<uint64_t>(fileInfo.st_ino));
+            }
+        if (hasFileInfo && fileInfo.st_size > 0)
+            {
+            void* view = ::mmap(nullptr, static_cast<size_t>(fileInfo.st_size),
+                                PROT_READ, MAP_SHARED, fileDescriptor, 0);
+            if (view != MAP_FAILED)
+                {
+                // the mapping stays valid after the descriptor is closed
+                ::close(fileDescriptor);
+                m_data = static_cast<const char*>(view);
+                m_length = static_cast<size_t>(fileInfo.st_size);
+                m_mapped = true;
+                return true;
+                }
+            }
+        ::close(fileDescriptor);
+        }
+#endif
+
+    // couldn't map it (or it's empty), so read it the old-fashioned way
+    wxFile file(filePath, wxFile::read);
+    if (!file.IsOpened())
+        { return false; }
+    const wxFileOffset fileLength = file.Length();
+    m_content.resize(fileLength > 0 ? static_cast<size_t>(fileLength) : 0);
+    const ssize_t bytesRead = m_content.empty() ? 0 : file.Read(m_content.data(), m_content.length());
+    m_content.resize(bytesRead > 0 ? static_cast<size_t>(bytesRead) : 0);
+    m_data = m_content.data();
+    m_length = m_content.length();
+    return true;
+    }
+
+bool wxMappedFile::GetFileInfo(const wxString& filePath, uint64_t& fileId, uint64_t& length)
+    {
+    fileId = length = 0;
+#ifdef __WXMSW__
+    // (opening it without any access rights is enough to query it)
+    HANDLE fileHandle = ::CreateFileW(filePath.wc_str(), 0,
+        FILE_SHARE_READ|FILE_SHARE_WRITE|FILE_SHARE_DELETE, nullptr,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (fileHandle == INVALID_HANDLE_VALUE)
+        { return false; }
+    BY_HANDLE_FILE_INFORMATION fileInfo{};
+    const bool hasFileInfo = ::GetFileInformationByHandle(fileHandle, &fileInfo);
+    ::CloseHandle(fileHandle);
+    if (!hasFileInfo)
+        { return false; }
+    fileId = MakeFileId(fileInfo.dwVolumeSerialNumber,
+        (static_cast<uint64_t>(fileInfo.nFileIndexHigh) << 32) | fileInfo.nFileIndexLow);
+    length = (static_cast<uint64_t>(fileInfo.nFileSizeHigh) << 32) | fileInfo.nFileSizeLow;
+#else
+    struct stat fileInfo{};
+    if (::stat(filePath.fn_str(), &fileInfo) != 0)
+        { return false; }
+    fileId = MakeFileId(static_cast<uint64_t>(fileInfo.st_dev), static_cast<uint64_t>(fileInfo.st_ino));
+    length = static_cast<uint64_t>(fileInfo.st_size);
+#endif
+    return true;
+    }
+
+bool wxMappedFile::MapForWriting(const wxString& filePath, const size_t length)
+    {
+    Unmap();
+    if (length == 0)
+        { return false; }
+#ifdef __WXMSW__
+    HANDLE fileHandle = ::CreateFileW(filePath.wc_str(), GENERIC_READ|GENERIC_WRITE,
+        FILE_SHARE_READ|FILE_SHARE_WRITE|FILE_SHARE_DELETE, nullptr,
+        OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (fileHandle == INVALID_HANDLE_VALUE)
+        { return false; }
+    // (mapping the file at this size resizes it)
+    const auto mappingSize = static_cast<unsigned long long>(length);
+    HANDLE mappingHandle = ::CreateFileMappingW(fileHandle, nullptr, PAGE_READWRITE,
+        static_cast<DWORD>(mappingSize >> 32), static_cast<DWORD>(mappingSize & 0xFFFFFFFF), nullptr);
+    if (mappingHandle != nullptr)
+        {
+        void* view = ::MapViewOfFile(mappingHandle, FILE_MAP_WRITE, 0, 0, length);
+        if (view != nullptr)
+            {
+            m_fileHandle = fileHandle;
+            m_mappingHandle = mappingHandle;
+            m_data = static_cast<const char*>(view);
+            m_length = length;
+            m_mapped = m_writable = true;
+            return true;
+            }
+        ::CloseHandle(mappingHandle);
+        }
+    ::CloseHandle(fileHandle);
+#else
+    const int fileDescriptor = ::open(filePath.fn_str(), O_RDWR|O_CREAT, 0644);
+    if (fileDescriptor == -1)
+        { return false; }
+    struct stat fileInfo{};
+    if (::fstat(fileDescriptor, &fileInfo) == 0 &&
+        (static_cast<size_t>(fileInfo.st_size) == length ||
+         ::ftruncate(fileDescriptor, static_cast<off_t>(length)) == 0))
+        {
+        void* view = ::mmap(nullptr, length, PROT_READ|PROT_WRITE, MAP_SHARED, fileDescriptor, 0);
+        if (view != MAP_FAILED)
+            {
+            ::close(fileDescriptor);
+            m_data = static_cast<const char*>(view);
+            m_length = length;
+            m_mapped = m_writable = true;
+            return true;
+            }
+        }
+    ::close(fileDescriptor);
+#endif
+    return false;
+    }
+
+bool wxMappedFile::Sync()
+    {
+    if (!m_writable)
+        { return false; }
+#ifdef __WXMSW__
+    return ::FlushViewOfFile(m_data, 0) &&
+        ::FlushFileBuffers(static_cast<HANDLE>(m_fileHandle));
+#else
+    return ::msync(const_cast<char*>(m_data), m_length, MS_SYNC) == 0;
+#endif
+    }
+
+void wxMappedFile::Unmap()
+    {
+    if (m_mapped)
+        {
+    #ifdef __WXMSW__
+        ::UnmapViewOfFile(m_data);
+        ::CloseHandle(static_cast<HANDLE>(m_mappingHandle));
+        ::CloseHandle(static_cast<HANDLE>(m_fileHandle));
+        m_mappingHandle = m_fileHandle = nullptr;
+    #else
+        ::munmap(const_cast<char*>(m_data), m_length);
+    #endif
+        }
+    m_content.clear();
+    m_content.shrink_to_fit();
+    m_data = nullptr;
+    m_length = 0;
+    m_fileId = 0;
+    m_mapped = m_writable = false;
+    }
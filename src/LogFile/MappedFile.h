@@ -0,0 +1,101 @@
+/** @addtogroup wxCode
+    @brief A collection of wxWidget tools.
+    @date 2005-2021
+    @copyright Oleander Software, Ltd.
+    @author Blake Madden
+    @details This program is free software; you can redistribute it and/or modify
+    it under the terms of the BSD License.
+* @{*/
+
+#ifndef __WXMAPPED_FILE_H__
+#define __WXMAPPED_FILE_H__
+
+#include <wx/wx.h>
+#include <wx/string.h>
+#include <wx/file.h>
+#include <cstdint>
+#include <string>
+
+/** @brief View of a file's content, memory-mapped where the platform supports it.
+
+    If the file can't be mapped, then its content is read into memory instead,
+    so callers can always use GetData() the same way.
+
+    A file can also be mapped for writing with MapForWriting(). Changes to a writable
+    mapping are kept by the OS even if the program crashes before it unmaps the file.*/
+class wxMappedFile
+    {
+public:
+    wxMappedFile() = default;
+    /// Constructor, which maps the file.
+    /// @param filePath The file to map.
+    explicit wxMappedFile(const wxString& filePath)
+        { Map(filePath); }
+    /// Destructor, which unmaps the file.
+    ~wxMappedFile()
+        { Unmap(); }
+
+    /** @brief Maps a file, unmapping the previous one (if any).
+        @param filePath The file to map.
+        @returns @c true if the file's content is available.*/
+    bool Map(const wxString& filePath);
+    /** @brief Maps a file for reading and writing, unmapping the previous one (if any).
+        @details The file is created if it doesn't exist, and is resized to @c length.
+            Unlike Map(), there is no fallback if the file can't be mapped.
+        @param filePath The file to map.
+        @param length The size that the file should be.
+        @returns @c true if the file was mapped.*/
+    bool MapForWriting(const wxString& filePath, const size_t length);
+    /// Unmaps the file.
+    void Unmap();
+    /** @brief Asks the OS to write the changes to a writable mapping to the disk.
+        @details This isn't needed for the changes to survive the program crashing,
+            only for them to survive the system crashing.
+        @returns @c true if the changes were written.*/
+    bool Sync();
+
+    /// @returns The start of the file's content.
+    [[nodiscard]] const char* GetData() const noexcept
+        { return m_data; }
+    /// @returns The length of the file's content.
+    [[nodiscard]] size_t GetLength() const noexcept
+        { return m_length; }
+    /// @returns @c true if the content is memory mapped (as opposed to read into memory).
+    [[nodiscard]] bool IsMapped() const noexcept
+        { return m_mapped; }
+    /** @returns An ID for the file that was mapped (built from its device and inode, or its
+            volume and file index on Windows), or @c 0 if it isn't known.
+        @details This tells whether a path still refers to the same file (e.g., whether a log
+            file was rotated, or deleted and created again) when it is mapped again.*/
+    [[nodiscard]] uint64_t GetFileId() const noexcept
+        { return m_fileId; }
+    /** @brief Looks up a file's ID (see GetFileId()) and size, without mapping or reading it.
+        @details Comparing these to a mapping tells whether the file was truncated
+            (reading a mapping past the end of its file faults) or replaced.
+        @param filePath The file.
+        @param[out] fileId The file's ID, or @c 0 if it isn't known.
+        @param[out] length The file's size.
+        @returns @c false if the file couldn't be looked up (e.g., it doesn't exist).*/
+    static bool GetFileInfo(const wxString& filePath, uint64_t& fileId, uint64_t& length);
+    /// @returns The start of the file's content if it was mapped for writing, otherwise @c nullptr.
+    [[nodiscard]] char* GetWritableData() noexcept
+        { return m_writable ? const_cast<char*>(m_data) : nullptr; }
+private:
+    const char* m_data{ nullptr };
+    size_t m_length{ 0 };
+    bool m_mapped{ false };
+    bool m_writable{ false };
+    uint64_t m_fileId{ 0 };
+    // used if the file couldn't be mapped
+    std::string m_content;
+#ifdef __WXMSW__
+    void* m_fileHandle{ nullptr };
+    void* m_mappingHandle{ nullptr };
+#endif
+
+    wxDECLARE_NO_COPY_CLASS(wxMappedFile);
+    };
+
+/** @}*/
+
+#endif //__WXMAPPED_FILE_H__